@@ -0,0 +1,70 @@
+#include <iostream>
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "camera.h"
+#include "scenes.h"
+#include "integrator.h"
+#include "typed_list.h"
+#include "light_list.h"
+#include "sampler.h"
+#include "counting_allocator.h"
+
+//  cornell box ׷ ray_color ·ÿĶѷ 0 0 ʱ 1
+// ȫֵ operator new ֻ滻counting_allocator.cppȾӰ
+
+// ׷ samples  ray_color ·ֱӹղͻPDFַʽһ飩ڼĶѷ
+long long allocation_check(const hittable& world, const light_list& lights, int samples, int max_depth, bool use_sobol)
+{
+    const int width = 64;
+    camera cam(vec3(278, 278, -800), vec3(278, 278, 0), vec3(0, 1, 0), 40, 1, 0, 10, 0, 1);
+    sobol_sampler sampler;
+    sampler.image_width = width;
+    sampler.samples_per_pixel = samples;
+    active_sampler() = use_sobol ? &sampler : nullptr;
+
+    heap_allocations = 0;
+    count_allocations = true;
+    real sink = 0;
+    for (int mode = 0; mode < 2; mode++)
+    {
+        next_event_estimation = mode == 0;
+        for (int s = 0; s < samples; s++)
+        {
+            int pixel = s % (width * width);
+            sampler.start_sample(pixel, s);
+            auto u = (pixel % width + sample_1d(sample_dim::pixel_x)) / (width - 1);
+            auto v = (pixel / width + sample_1d(sample_dim::pixel_y)) / (width - 1);
+            sink += ray_color(cam.get_ray(u, v), color(0, 0, 0), world, lights, max_depth).x();
+        }
+    }
+    count_allocations = false;
+    active_sampler() = nullptr;
+
+    std::cout << "Allocation check" << (use_sobol ? " (sobol)" : " (independent)") << ": " << heap_allocations
+              << " heap allocations in " << 2 * samples << " ray_color samples (" << sink << ")\n";
+    return heap_allocations;
+}
+
+int main()
+{
+    const int samples = 100000;
+    const int max_depth = 50;
+
+    hittable_list world(arena_make<typed_list>(cornell_box().objects));
+    world.compile(current_scene());
+    std::vector<shared_ptr<hittable>> found_lights;
+    world.collect_lights(nullptr, found_lights);
+    light_list lights(found_lights);
+
+    long long allocations = 0;
+    for (bool use_sobol : { true, false })
+        allocations += allocation_check(world, lights, samples, max_depth, use_sobol);
+
+    if (allocations != 0)
+    {
+        std::cerr << "Allocation check failed: ray_color allocated on the heap\n";
+        return 1;
+    }
+    return 0;
+}
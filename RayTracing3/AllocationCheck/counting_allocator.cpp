@@ -0,0 +1,27 @@
+#include <cstdlib>
+#include <new>
+#include "counting_allocator.h"
+
+// 滻ȫֵ operator new/deleteڵı뵥Ԫ new/delete Ĵ뿴ʵ֣
+// ȥٰ malloc/free  new/delete Լ
+std::atomic<long long> heap_allocations(0);
+std::atomic<bool> count_allocations(false);
+
+void* operator new(size_t size)
+{
+    if (count_allocations.load(std::memory_order_relaxed))
+        heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
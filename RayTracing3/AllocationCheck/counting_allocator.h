@@ -0,0 +1,10 @@
+#ifndef COUNTING_ALLOCATOR_H
+#define COUNTING_ALLOCATOR_H
+
+#include <atomic>
+
+// ѷcounting_allocator.cpp 滻ȫֵ operator newcount_allocations ʱÿηһ
+extern std::atomic<long long> heap_allocations;
+extern std::atomic<bool> count_allocations;
+
+#endif
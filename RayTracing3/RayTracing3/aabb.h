@@ -1,6 +1,7 @@
 #ifndef AABB_H
 #define AABB_H
 #include "rtweekend.h"
+#include "ray_packet.h"
 
 // AABB:İΧ
 class aabb 
@@ -12,7 +13,8 @@ public:
     vec3 min() const { return _min; }
     vec3 max() const { return _max; }
 
-    bool hit(const ray& r, double tmin, double tmax) const;
+    bool hit(const ray& r, real tmin, real tmax) const;
+    unsigned hit_packet(const ray_packet& rp, real tmin, const real* tmax, unsigned active) const;
 
 public:
     vec3 _min;
@@ -21,7 +23,7 @@ public:
 
 //Andrew Kensler's hit method
 //ԿĻȥһЩظ, Ż˲
-inline bool aabb::hit(const ray& r, double tmin, double tmax) const 
+inline bool aabb::hit(const ray& r, real tmin, real tmax) const 
 {
     for (int a = 0; a < 3; a++) {
         auto invD = 1.0f / r.direction()[a];
@@ -37,6 +39,35 @@ inline bool aabb::hit(const ray& r, double tmin, double tmax) const
     return true;
 }
 
+// ߰Χ󽻣رеĹ
+// ΧֻһΣÿߵ slab ޷֧Զ
+inline unsigned aabb::hit_packet(const ray_packet& rp, real tmin, const real* tmax, unsigned active) const
+{
+    real t0[packet_size];
+    real t1[packet_size];
+    for (int i = 0; i < packet_size; i++)
+    {
+        t0[i] = tmin;
+        t1[i] = tmax[i];
+    }
+    for (int a = 0; a < 3; a++)
+    {
+        const real lo = _min[a];
+        const real hi = _max[a];
+        for (int i = 0; i < packet_size; i++)
+        {
+            auto ta = (lo - rp.orig[a][i]) * rp.inv_dir[a][i];
+            auto tb = (hi - rp.orig[a][i]) * rp.inv_dir[a][i];
+            t0[i] = ffmax(t0[i], ffmin(ta, tb));
+            t1[i] = ffmin(t1[i], ffmax(ta, tb));
+        }
+    }
+    unsigned mask = 0;
+    for (int i = 0; i < packet_size; i++)
+        mask |= unsigned(t0[i] < t1[i]) << i;
+    return mask & active;
+}
+
 // ΧеİΧ
 aabb surrounding_box(aabb box0, aabb box1) 
 {
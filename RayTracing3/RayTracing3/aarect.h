@@ -4,26 +4,176 @@
 #include "rtweekend.h"
 #include "hittable.h"
 
+// ǲιԴUrena, Fajardo, King 2013, "An Area-Preserving Parametrization for
+// Spherical Rectangles"ȡʱýĴԴԵܶԶԵķ
+// ֱܴھųɵϾȡܶȴ 1 / 
+// ̫Сʱʽᶪʧȣʱ˻ذֻɫ pdf һ
+
+//  [x0,x1]x[y0,y1]ƽԭľΪ hԭųɵǣʽֻҪ 4  atan
+inline real rect_solid_angle(real x0, real x1, real y0, real y1, real h)
+{
+    if (!(h > 0))
+        return 0;
+
+    auto f = [h](real x, real y) { return atan(x * y / (h * sqrt(x * x + y * y + h * h))); };
+    return f(x1, y1) - f(x0, y1) - f(x1, y0) + f(x0, y0);
+}
+
+const real rect_min_solid_angle = 1e-4;
+
+// ιԴ v ĸܶȡab ǾƽɫķΧh ɫ㵽ƽľ룬
+// t  v ƽĲv_normal  v ƽ淨ϵķ
+inline real rect_direction_pdf(real a0, real a1, real b0, real b1, real h, const vec3& v, real t, real v_normal)
+{
+    auto solid_angle = rect_solid_angle(a0, a1, b0, b1, h);
+    if (solid_angle > rect_min_solid_angle)
+        return 1 / solid_angle;
+
+    auto area = (a1 - a0) * (b1 - b0);
+    auto distance_squared = t * t * v.length_squared();
+    auto cosine = fabs(v_normal) / v.length();
+    return distance_squared / (cosine * area);
+}
+
+struct spherical_rect
+{
+    // corner Ǿεһǣexey Ǵǳ໥ֱ
+    spherical_rect(const point3& origin, const point3& corner, const vec3& ex, const vec3& ey)
+        : o(origin)
+    {
+        auto exl = ex.length();
+        auto eyl = ey.length();
+        x = ex / exl;
+        y = ey / eyl;
+        z = cross(x, y);
+
+        auto d = corner - o;
+        z0 = dot(d, z);
+        if (z0 > 0)
+        {
+            z = -z;
+            z0 = -z0;
+        }
+        x0 = dot(d, x);
+        y0 = dot(d, y);
+        x1 = x0 + exl;
+        y1 = y0 + eyl;
+
+        // ĸ㷽ڴԲķߣԼεڽǣ
+        // ǣĸڽ֮ͼ 2Уñʽ㣬 rect_direction_pdf ȫһ
+        vec3 v00(x0, y0, z0), v01(x0, y1, z0), v10(x1, y0, z0), v11(x1, y1, z0);
+        auto n0 = unit_vector(cross(v00, v10));
+        auto n2 = unit_vector(cross(v11, v01));
+        auto n3 = unit_vector(cross(v01, v00));
+        auto g2 = acos(clamp(-dot(n2, n3), -1, 1));
+        auto g3 = acos(clamp(-dot(n3, n0), -1, 1));
+
+        b0 = n0.z();
+        b1 = n2.z();
+        k = 2 * pi - g2 - g3;
+        solid_angle = rect_solid_angle(x0, x1, y0, y1, -z0);
+    }
+
+    bool use_solid_angle() const { return solid_angle > rect_min_solid_angle; }
+
+    //  (u, v) Ӧĵķ
+    vec3 sample(real u, real v) const
+    {
+        if (!use_solid_angle())
+            return x * (x0 + u * (x1 - x0)) + y * (y0 + v * (y1 - y0)) + z * z0;
+
+        auto au = u * solid_angle + k;
+        auto fu = (cos(au) * b0 - b1) / sin(au);
+        auto cu = clamp((fu > 0 ? 1 : -1) / sqrt(fu * fu + b0 * b0), -1, 1);
+        auto xu = clamp(-(cu * z0) / sqrt(ffmax(1 - cu * cu, 0)), x0, x1);
+
+        auto dist = sqrt(xu * xu + z0 * z0);
+        auto h0 = y0 / sqrt(dist * dist + y0 * y0);
+        auto h1 = y1 / sqrt(dist * dist + y1 * y1);
+        auto hv = h0 + v * (h1 - h0);
+        auto hv2 = hv * hv;
+        auto yv = hv2 < 1 - real(1e-6) ? (hv * dist) / sqrt(1 - hv2) : y1;
+
+        return x * xu + y * yv + z * z0;
+    }
+
+    point3 o;
+    vec3 x, y, z;
+    real x0, x1, y0, y1, z0;
+    real b0, b1, k;
+    real solid_angle;
+};
+
 // xyƽ
 class xy_rect : public hittable 
 {
 public:
     xy_rect() {}
 
-    xy_rect(double _x0, double _x1, double _y0, double _y1, double _k, shared_ptr<material> mat)
-        : x0(_x0), x1(_x1), y0(_y0), y1(_y1), k(_k), mp(mat) {};
+    xy_rect(real _x0, real _x1, real _y0, real _y1, real _k, shared_ptr<material> mat)
+        : x0(_x0), x1(_x1), y0(_y0), y1(_y1), k(_k), mat_ptr(mat) {};
 
-    virtual bool hit(const ray& r, double t0, double t1, hit_record& rec) const;
+    virtual bool hit(const ray& r, real t0, real t1, hit_record& rec) const;
+    virtual void get_hit_attributes(const ray& r, hit_record& rec) const;
 
-    virtual bool bounding_box(double t0, double t1, aabb& output_box) const 
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const 
     {
         output_box = aabb(vec3(x0, y0, k - 0.0001), vec3(x1, y1, k + 0.0001));
         return true;
     }
 
+    // ǲ spherical_rectֻƽ󽻣Ҫ hit_record
+    virtual real pdf_value(const point3& origin, const vec3& v) const override
+    {
+        auto t = (k - origin.z()) / v.z();
+        if (!(t > 0.001))
+            return 0;
+        auto x = origin.x() + t * v.x();
+        auto y = origin.y() + t * v.y();
+        if (!(x >= x0 && x <= x1 && y >= y0 && y <= y1))
+            return 0;
+
+        return rect_direction_pdf(x0 - origin.x(), x1 - origin.x(), y0 - origin.y(), y1 - origin.y(),
+                                  fabs(k - origin.z()), v, t, v.z());
+    }
+
+    virtual vec3 random(const point3& origin) const override
+    {
+        spherical_rect sr(origin, point3(x0, y0, k), vec3(x1 - x0, 0, 0), vec3(0, y1 - y0, 0));
+        return sr.sample(sample_1d(sample_dim::bounce_u), sample_1d(sample_dim::bounce_v));
+    }
+
+    virtual void compile(scene_storage& scene) override
+    {
+        mat_id = scene.add_material(mat_ptr);
+    }
+
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const override
+    {
+        if (emits_light(mat_id))
+            lights.push_back(self);
+    }
+
+    virtual real light_power() const override
+    {
+        return (x1 - x0) * (y1 - y0) * pi * emitted_luminance(mat_id);
+    }
+
+    virtual bool sample_point(surface_sample& s) const override
+    {
+        s.p = point3(random_double(x0, x1), random_double(y0, y1), k);
+        s.normal = vec3(0, 0, 1);
+        s.u = (s.p.x() - x0) / (x1 - x0);
+        s.v = (s.p.y() - y0) / (y1 - y0);
+        s.mat_id = mat_id;
+        s.area_pdf = 1 / ((x1 - x0) * (y1 - y0));
+        return true;
+    }
+
 public:
-    shared_ptr<material> mp;
-    double x0, x1, y0, y1, k;
+    real x0, x1, y0, y1, k;
+    shared_ptr<material> mat_ptr;
+    uint32_t mat_id = 0;            // ±꣬compile ֮Ч
 };
 
 // xzƽ
@@ -32,39 +182,70 @@ class xz_rect : public hittable
 public:
     xz_rect() {}
 
-    xz_rect(double _x0, double _x1, double _z0, double _z1, double _k, shared_ptr<material> mat)
-        : x0(_x0), x1(_x1), z0(_z0), z1(_z1), k(_k), mp(mat) {};
+    xz_rect(real _x0, real _x1, real _z0, real _z1, real _k, shared_ptr<material> mat)
+        : x0(_x0), x1(_x1), z0(_z0), z1(_z1), k(_k), mat_ptr(mat) {};
 
-    virtual bool hit(const ray& r, double t0, double t1, hit_record& rec) const;
+    virtual bool hit(const ray& r, real t0, real t1, hit_record& rec) const;
+    virtual void get_hit_attributes(const ray& r, hit_record& rec) const;
 
-    virtual bool bounding_box(double t0, double t1, aabb& output_box) const 
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const 
     {
         output_box = aabb(vec3(x0, k - 0.0001, z0), vec3(x1, k + 0.0001, z1));
         return true;
     }
 
-    virtual double pdf_value(const point3& origin, const vec3& v) const override
+    // ǲ spherical_rectֻƽ󽻣Ҫ hit_record
+    virtual real pdf_value(const point3& origin, const vec3& v) const override
     {
-        hit_record rec;
-        if (!this->hit(ray(origin, v), 0.001, infinity, rec))
+        auto t = (k - origin.y()) / v.y();
+        if (!(t > 0.001))
+            return 0;
+        auto x = origin.x() + t * v.x();
+        auto z = origin.z() + t * v.z();
+        if (!(x >= x0 && x <= x1 && z >= z0 && z <= z1))
             return 0;
 
-        auto area = (x1 - x0) * (z1 - z0);
-        auto distance_squared = rec.t * rec.t * v.length_squared();
-        auto cosine = fabs(dot(v, rec.normal) / v.length());
-
-        return distance_squared / (cosine * area);
+        return rect_direction_pdf(x0 - origin.x(), x1 - origin.x(), z0 - origin.z(), z1 - origin.z(),
+                                  fabs(k - origin.y()), v, t, v.y());
     }
 
     virtual vec3 random(const point3& origin) const override
     {
-        auto random_point = point3(random_double(x0, x1), k, random_double(z0, z1));
-        return random_point - origin;
+        spherical_rect sr(origin, point3(x0, k, z0), vec3(x1 - x0, 0, 0), vec3(0, 0, z1 - z0));
+        return sr.sample(sample_1d(sample_dim::bounce_u), sample_1d(sample_dim::bounce_v));
+    }
+
+    virtual void compile(scene_storage& scene) override
+    {
+        mat_id = scene.add_material(mat_ptr);
+    }
+
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const override
+    {
+        if (emits_light(mat_id))
+            lights.push_back(self);
+    }
+
+    virtual real light_power() const override
+    {
+        return (x1 - x0) * (z1 - z0) * pi * emitted_luminance(mat_id);
+    }
+
+    virtual bool sample_point(surface_sample& s) const override
+    {
+        s.p = point3(random_double(x0, x1), k, random_double(z0, z1));
+        s.normal = vec3(0, 1, 0);
+        s.u = (s.p.x() - x0) / (x1 - x0);
+        s.v = (s.p.z() - z0) / (z1 - z0);
+        s.mat_id = mat_id;
+        s.area_pdf = 1 / ((x1 - x0) * (z1 - z0));
+        return true;
     }
 
 public:
-    shared_ptr<material> mp;
-    double x0, x1, z0, z1, k;
+    real x0, x1, z0, z1, k;
+    shared_ptr<material> mat_ptr;
+    uint32_t mat_id = 0;            // ±꣬compile ֮Ч
 };
 
 // yzƽ
@@ -73,24 +254,74 @@ class yz_rect : public hittable
 public:
     yz_rect() {}
 
-    yz_rect(double _y0, double _y1, double _z0, double _z1, double _k, shared_ptr<material> mat)
-        : y0(_y0), y1(_y1), z0(_z0), z1(_z1), k(_k), mp(mat) {};
+    yz_rect(real _y0, real _y1, real _z0, real _z1, real _k, shared_ptr<material> mat)
+        : y0(_y0), y1(_y1), z0(_z0), z1(_z1), k(_k), mat_ptr(mat) {};
 
-    virtual bool hit(const ray& r, double t0, double t1, hit_record& rec) const;
+    virtual bool hit(const ray& r, real t0, real t1, hit_record& rec) const;
+    virtual void get_hit_attributes(const ray& r, hit_record& rec) const;
 
-    virtual bool bounding_box(double t0, double t1, aabb& output_box) const 
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const 
     {
         output_box = aabb(vec3(k - 0.0001, y0, z0), vec3(k + 0.0001, y1, z1));
         return true;
     }
 
+    // ǲ spherical_rectֻƽ󽻣Ҫ hit_record
+    virtual real pdf_value(const point3& origin, const vec3& v) const override
+    {
+        auto t = (k - origin.x()) / v.x();
+        if (!(t > 0.001))
+            return 0;
+        auto y = origin.y() + t * v.y();
+        auto z = origin.z() + t * v.z();
+        if (!(y >= y0 && y <= y1 && z >= z0 && z <= z1))
+            return 0;
+
+        return rect_direction_pdf(y0 - origin.y(), y1 - origin.y(), z0 - origin.z(), z1 - origin.z(),
+                                  fabs(k - origin.x()), v, t, v.x());
+    }
+
+    virtual vec3 random(const point3& origin) const override
+    {
+        spherical_rect sr(origin, point3(k, y0, z0), vec3(0, y1 - y0, 0), vec3(0, 0, z1 - z0));
+        return sr.sample(sample_1d(sample_dim::bounce_u), sample_1d(sample_dim::bounce_v));
+    }
+
+    virtual void compile(scene_storage& scene) override
+    {
+        mat_id = scene.add_material(mat_ptr);
+    }
+
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const override
+    {
+        if (emits_light(mat_id))
+            lights.push_back(self);
+    }
+
+    virtual real light_power() const override
+    {
+        return (y1 - y0) * (z1 - z0) * pi * emitted_luminance(mat_id);
+    }
+
+    virtual bool sample_point(surface_sample& s) const override
+    {
+        s.p = point3(k, random_double(y0, y1), random_double(z0, z1));
+        s.normal = vec3(1, 0, 0);
+        s.u = (s.p.y() - y0) / (y1 - y0);
+        s.v = (s.p.z() - z0) / (z1 - z0);
+        s.mat_id = mat_id;
+        s.area_pdf = 1 / ((y1 - y0) * (z1 - z0));
+        return true;
+    }
+
 public:
-    shared_ptr<material> mp;
-    double y0, y1, z0, z1, k;
+    real y0, y1, z0, z1, k;
+    shared_ptr<material> mat_ptr;
+    uint32_t mat_id = 0;            // ±꣬compile ֮Ч
 };
 
 // Ƿо
-bool xy_rect::hit(const ray& r, double t0, double t1, hit_record& rec) const 
+bool xy_rect::hit(const ray& r, real t0, real t1, hit_record& rec) const 
 {
     auto t = (k - r.origin().z()) / r.direction().z();
     if (t < t0 || t > t1)
@@ -99,18 +330,26 @@ bool xy_rect::hit(const ray& r, double t0, double t1, hit_record& rec) const
     auto y = r.origin().y() + t * r.direction().y();
     if (x < x0 || x > x1 || y < y0 || y > y1)
         return false;
-    rec.u = (x - x0) / (x1 - x0);
-    rec.v = (y - y0) / (y1 - y0);
+    // Ȱƽڵľֲݴ uv һ get_hit_attributes
+    rec.u = x;
+    rec.v = y;
     rec.t = t;
+    rec.object = this;
+    return true;
+}
+
+void xy_rect::get_hit_attributes(const ray& r, hit_record& rec) const
+{
+    rec.u = (rec.u - x0) / (x1 - x0);
+    rec.v = (rec.v - y0) / (y1 - y0);
     vec3 outward_normal = vec3(0, 0, 1);
     rec.set_face_normal(r, outward_normal);
-    rec.mat_ptr = mp;
-    rec.p = r.at(t);
-    return true;
+    rec.mat_id = mat_id;
+    rec.p = r.at(rec.t);
 }
 
 // Ƿо
-bool xz_rect::hit(const ray& r, double t0, double t1, hit_record& rec) const 
+bool xz_rect::hit(const ray& r, real t0, real t1, hit_record& rec) const 
 {
     auto t = (k - r.origin().y()) / r.direction().y();
     if (t < t0 || t > t1)
@@ -119,18 +358,26 @@ bool xz_rect::hit(const ray& r, double t0, double t1, hit_record& rec) const
     auto z = r.origin().z() + t * r.direction().z();
     if (x < x0 || x > x1 || z < z0 || z > z1)
         return false;
-    rec.u = (x - x0) / (x1 - x0);
-    rec.v = (z - z0) / (z1 - z0);
+    // Ȱƽڵľֲݴ uv һ get_hit_attributes
+    rec.u = x;
+    rec.v = z;
     rec.t = t;
+    rec.object = this;
+    return true;
+}
+
+void xz_rect::get_hit_attributes(const ray& r, hit_record& rec) const
+{
+    rec.u = (rec.u - x0) / (x1 - x0);
+    rec.v = (rec.v - z0) / (z1 - z0);
     vec3 outward_normal = vec3(0, 1, 0);
     rec.set_face_normal(r, outward_normal);
-    rec.mat_ptr = mp;
-    rec.p = r.at(t);
-    return true;
+    rec.mat_id = mat_id;
+    rec.p = r.at(rec.t);
 }
 
 // Ƿо
-bool yz_rect::hit(const ray& r, double t0, double t1, hit_record& rec) const 
+bool yz_rect::hit(const ray& r, real t0, real t1, hit_record& rec) const 
 {
     auto t = (k - r.origin().x()) / r.direction().x();
     if (t < t0 || t > t1)
@@ -139,14 +386,22 @@ bool yz_rect::hit(const ray& r, double t0, double t1, hit_record& rec) const
     auto z = r.origin().z() + t * r.direction().z();
     if (y < y0 || y > y1 || z < z0 || z > z1)
         return false;
-    rec.u = (y - y0) / (y1 - y0);
-    rec.v = (z - z0) / (z1 - z0);
+    // Ȱƽڵľֲݴ uv һ get_hit_attributes
+    rec.u = y;
+    rec.v = z;
     rec.t = t;
+    rec.object = this;
+    return true;
+}
+
+void yz_rect::get_hit_attributes(const ray& r, hit_record& rec) const
+{
+    rec.u = (rec.u - y0) / (y1 - y0);
+    rec.v = (rec.v - z0) / (z1 - z0);
     vec3 outward_normal = vec3(1, 0, 0);
     rec.set_face_normal(r, outward_normal);
-    rec.mat_ptr = mp;
-    rec.p = r.at(t);
-    return true;
+    rec.mat_id = mat_id;
+    rec.p = r.at(rec.t);
 }
 
 #endif // !AARECT_H
@@ -0,0 +1,111 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+#include "rtweekend.h"
+
+// ڴأ bump 
+// ͼԪʡͬ shared_ptr Ŀƿ飩䣬
+// һ𴴽ĶڴţʱֲԸãͷʱ黹ڴ棬
+// ٺ release() һͷڴ
+class scene_arena
+{
+public:
+    explicit scene_arena(size_t block_bytes = 1 << 20) : block_size(block_bytes) {}
+    ~scene_arena() { release(); }
+
+    scene_arena(const scene_arena&) = delete;
+    scene_arena& operator=(const scene_arena&) = delete;
+
+    void* allocate(size_t bytes, size_t align)
+    {
+        auto p = reinterpret_cast<uintptr_t>(cur);
+        auto aligned = (p + align - 1) & ~(uintptr_t(align) - 1);
+
+        if (cur == nullptr || aligned + bytes > reinterpret_cast<uintptr_t>(end))
+        {
+            // СĶ󵥶ռһ
+            add_block(bytes + align > block_size ? bytes + align : block_size);
+            p = reinterpret_cast<uintptr_t>(cur);
+            aligned = (p + align - 1) & ~(uintptr_t(align) - 1);
+        }
+
+        cur = reinterpret_cast<char*>(aligned + bytes);
+        used += bytes;
+        live++;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // 黹ڴ棬ֻѾ
+    void deallocate(void*)
+    {
+        live--;
+    }
+
+    // һͷȫڴ档ǰ뱣֤ĶѾlive_allocations() Ϊ 0
+    void release()
+    {
+        for (auto block : blocks)
+            ::operator delete(block);
+        blocks.clear();
+        cur = end = nullptr;
+        used = reserved = 0;
+    }
+
+    size_t bytes_used() const { return used; }          // ѷֽ
+    size_t bytes_reserved() const { return reserved; }  // ϵͳֽ
+    size_t live_allocations() const { return live; }    // ûй黹ķ䣨 shared_ptr ƿ飩
+
+    template <typename T, typename... Args>
+    shared_ptr<T> make(Args&&... args);
+
+private:
+    void add_block(size_t bytes)
+    {
+        cur = static_cast<char*>(::operator new(bytes));
+        end = cur + bytes;
+        blocks.push_back(cur);
+        reserved += bytes;
+    }
+
+    std::vector<char*> blocks;
+    char* cur = nullptr;
+    char* end = nullptr;
+    size_t used = 0;
+    size_t reserved = 0;
+    size_t live = 0;
+    size_t block_size;
+};
+
+//  std::allocate_shared õķdeallocate 黹ڴ棬ֻ¼
+template <typename T>
+struct arena_allocator
+{
+    using value_type = T;
+
+    arena_allocator(scene_arena* a) : arena(a) {}
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, size_t) { arena->deallocate(p); }
+
+    scene_arena* arena;
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T>& a, const arena_allocator<U>& b) { return a.arena == b.arena; }
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T>& a, const arena_allocator<U>& b) { return a.arena != b.arena; }
+
+template <typename T, typename... Args>
+shared_ptr<T> scene_arena::make(Args&&... args)
+{
+    return std::allocate_shared<T>(arena_allocator<T>(this), std::forward<Args>(args)...);
+}
+
+#endif
@@ -0,0 +1,542 @@
+#ifndef BDPT_H
+#define BDPT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "rtweekend.h"
+#include "hittable.h"
+#include "material.h"
+#include "camera.h"
+#include "light_list.h"
+
+// ˫·׷٣Veach 1997ṹ PBRT ʵ֣
+// ÿ͹Դһ·ٰ·ϵĶӣԴ·ȡ s 㡢
+// ·ȡ t һ· (s, t) ϰƽʽҪԲ
+// ܶһɻȣpdf_fwd ·ɶܶȣpdf_rev Ǵһ˷ɵܶȣ
+// ʱֻҪĶӴ pdf_rev Ե֮ܶȡ
+// t = 1 Ĳ԰ѹԴ·ϵĶֱĸȲ֪ԭӵۼӵ splat 
+// ֻ֧ material ĽӿڣǾ BRDF Ϊ ˥ * ɢPDF / cosȣ
+// ɢ䷽ scatter  surface_pdf MIS Ҫϵܶ material::sampling_pdf 㣻
+// 涥㲻ӣܶȼΪ 0MIS 
+struct bdpt_vertex
+{
+    enum kind_t { camera_end, light_end, surface };
+
+    kind_t kind = surface;
+    point3 p;
+    vec3 normal;            // 涥ΪһķߣԴΪһķߣΪ߷
+    hit_record rec;
+    ray r_in;               // 涥Ĺ
+    color beta;             // ·ΪֹĹ׳Բܶ
+    color attenuation;      // 涥ɢʱ˥
+    bool delta = false;     // 涥
+    bool emissive = false;  // 涥ڹԴϣ·˽
+    real pdf_fwd = 0;
+    real pdf_rev = 0;
+
+    // ܷһ·ĶҪ BRDF
+    bool connectible() const { return kind != surface || (!delta && !emissive); }
+};
+
+class bdpt_integrator
+{
+public:
+    bdpt_integrator(const hittable& w, const light_list& l, const color& bg, int depth)
+        : world(w), lights(l), background(bg), max_depth(depth) {}
+
+    // ͼ image[j * width + i] ţj = 0 һУѭһ£ûг spp
+    void render(const camera& cam, int width, int height, int spp, std::vector<color>& image);
+
+public:
+    int rr_min_depth = 3;
+    int threads = 1;
+    uint32_t seed = 1;
+    std::atomic<long long> rays_traced{ 0 };        // ·ϵĹߣģ
+    std::atomic<long long> shadow_rays_traced{ 0 }; // ʱĿɼԲ
+    std::atomic<long long> splats{ 0 };             // t = 1 Ĳۼӵ splat Ĵ
+
+private:
+    int camera_subpath(const ray& r, bdpt_vertex* path, color& escaped) const;
+    int light_subpath(real time, bdpt_vertex* path) const;
+    int random_walk(ray r, color start, real pdf_dir, bdpt_vertex* path, int max_vertices, color* escaped) const;
+
+    color connect(bdpt_vertex* light_path, bdpt_vertex* camera_path, int s, int t, real time, int& pixel, long long& shadows) const;
+    real mis_weight(bdpt_vertex* light_path, bdpt_vertex* camera_path, const bdpt_vertex& sampled, int s, int t) const;
+
+    // Ӷ v  next ܶȣfrom ǹߵ v ֮ǰĶ㣬nullptr ʾ v.r_in 
+    real pdf(const bdpt_vertex& v, const bdpt_vertex& next, const bdpt_vertex* from = nullptr) const;
+    // Դ v ҷֲߡ䵽 next ܶ
+    real pdf_light(const bdpt_vertex& v, const bdpt_vertex& next) const;
+    // Դ·ȡ v ܶȣѡԴڱϾȡ
+    real pdf_light_origin(const bdpt_vertex& v) const
+    {
+        return lights.total_power > 0 ? pi * emitted_luminance(v.rec.mat_id) / lights.total_power : 0;
+    }
+
+    // ܶȻ㵽 to ܶ
+    static real convert_density(real pdf, const bdpt_vertex& from, const bdpt_vertex& to)
+    {
+        auto w = to.p - from.p;
+        auto dist2 = w.length_squared();
+        if (pdf == 0 || dist2 == 0)
+            return 0;
+        pdf /= dist2;
+        if (to.kind != bdpt_vertex::camera_end)
+            pdf *= fabs(dot(to.normal, w)) / sqrt(dist2);
+        return pdf;
+    }
+
+    // 涥 v  w ɢ BRDF
+    static color brdf(const bdpt_vertex& v, const vec3& w)
+    {
+        auto cos_theta = dot(v.normal, w) / w.length();
+        if (!(cos_theta > 0))
+            return color(0, 0, 0);
+        ray out(v.p, w, v.r_in.time());
+        return v.attenuation * (current_scene().mat(v.rec.mat_id).scattering_pdf(v.r_in, v.rec, out) / cos_theta);
+    }
+
+    bool visible(const point3& a, const point3& b, real time, long long& shadows) const
+    {
+        shadows++;
+        auto w = b - a;
+        auto dist = w.length();
+        hit_record rec;
+        return !world.hit(ray(a, w / dist, time), 0.001, dist - 0.001, rec);
+    }
+
+    //  x ķĸأcos_theta ߷ļн
+    bool project(const point3& x, int& pixel, real& cos_theta) const;
+
+    // ĳҪԳңҲؾȲܶ
+    real importance(real cos_theta) const
+    {
+        return 1 / (image_area * cos_theta * cos_theta * cos_theta);
+    }
+
+private:
+    const hittable& world;
+    const light_list& lights;
+    color background;
+    int max_depth;
+
+    // render ʱȡĲ
+    point3 cam_origin;
+    vec3 forward;
+    point3 lower_left;
+    vec3 horizontal, vertical;
+    real plane_distance = 1;
+    real image_area = 1;        // ͼھΪ 1 ƽϵ
+    int image_width = 0, image_height = 0;
+};
+
+void bdpt_integrator::render(const camera& cam, int width, int height, int spp, std::vector<color>& image)
+{
+    cam_origin = cam.origin;
+    forward = -cam.w;
+    lower_left = cam.lower_left_corner;
+    horizontal = cam.horizontal;
+    vertical = cam.vertical;
+    plane_distance = dot(lower_left - cam_origin, forward);
+    image_width = width;
+    image_height = height;
+    // ѭ (i + ) / (width - 1) ȡأͼ horizontalvertical ųɵľԴ
+    image_area = horizontal.length() * vertical.length() / (plane_distance * plane_distance)
+               * width / (width - 1) * height / (height - 1);
+
+    image.assign(size_t(width) * height, color(0, 0, 0));
+    std::vector<std::atomic<real>> splat(size_t(width) * height * 3);
+    for (auto& s : splat)
+        s.store(0, std::memory_order_relaxed);
+
+    // ̰߳ȡÿһпͷк趨ӣ·߳޹
+    // splat ۼ˳򲻹̶ֻϵĲ
+    std::atomic<int> next_row{ 0 };
+    auto worker = [&]()
+    {
+        camera local_cam = cam;
+        std::vector<bdpt_vertex> camera_path(max_depth + 2), light_path(max_depth + 1);
+        long long rays = 0, shadows = 0;
+
+        for (int j; (j = next_row++) < height; )
+        {
+            seed_random(seed * 2654435761u + uint32_t(j) * 40503u + 1);
+            for (int i = 0; i < width; ++i)
+            {
+                color sum(0, 0, 0);
+                for (int k = 0; k < spp; ++k)
+                {
+                    auto u = (i + random_double()) / (width - 1);
+                    auto v = (j + random_double()) / (height - 1);
+                    ray r = local_cam.get_ray(u, v);
+
+                    color escaped(0, 0, 0);
+                    int nc = camera_subpath(r, camera_path.data(), escaped);
+                    int nl = light_subpath(r.time(), light_path.data());
+                    sum += escaped * background;
+                    rays += (nc - 1) + std::max(nl - 1, 0);
+
+                    for (int t = 1; t <= nc; t++)
+                    {
+                        for (int s = 0; s <= nl; s++)
+                        {
+                            int depth = s + t - 2;
+                            if ((s == 1 && t == 1) || depth < 0 || depth > max_depth)
+                                continue;
+
+                            int pixel = -1;
+                            auto c = connect(light_path.data(), camera_path.data(), s, t, r.time(), pixel, shadows);
+                            if (t != 1)
+                            {
+                                sum += c;
+                            }
+                            else if (pixel >= 0 && (c.x() > 0 || c.y() > 0 || c.z() > 0))
+                            {
+                                // std::atomic<double>  C++14 û fetch_addñȽϽʵ
+                                for (int a = 0; a < 3; a++)
+                                {
+                                    auto& target = splat[size_t(pixel) * 3 + a];
+                                    real old = target.load(std::memory_order_relaxed);
+                                    while (!target.compare_exchange_weak(old, old + c[a], std::memory_order_relaxed))
+                                        ;
+                                }
+                                splats.fetch_add(1, std::memory_order_relaxed);
+                            }
+                        }
+                    }
+                }
+                image[size_t(j) * width + i] = sum;
+            }
+        }
+        rays_traced += rays;
+        shadow_rays_traced += shadows;
+    };
+
+    // ߳̿˵Ͳ߳ûУ߶ø߳Լ random_double
+    std::vector<std::thread> workers;
+    for (int t = 0; t < std::max(threads, 1); t++)
+        workers.emplace_back(worker);
+    for (auto& w : workers)
+        w.join();
+
+    // splat ÿĹ֮ͣصĽһ write_color  spp
+    for (size_t p = 0; p < image.size(); p++)
+        image[p] += color(splat[p * 3].load(), splat[p * 3 + 1].load(), splat[p * 3 + 2].load());
+}
+
+bool bdpt_integrator::project(const point3& x, int& pixel, real& cos_theta) const
+{
+    auto d = x - cam_origin;
+    auto along = dot(d, forward);
+    if (!(along > 0))
+        return false;
+    cos_theta = along / d.length();
+
+    // ƽĽ㻻ѭ (u, v)
+    auto q = cam_origin + d * (plane_distance / along) - lower_left;
+    auto u = dot(q, horizontal) / horizontal.length_squared();
+    auto v = dot(q, vertical) / vertical.length_squared();
+    auto i = static_cast<int>(floor(u * (image_width - 1)));
+    auto j = static_cast<int>(floor(v * (image_height - 1)));
+    if (i < 0 || i >= image_width || j < 0 || j >= image_height)
+        return false;
+
+    pixel = j * image_width + i;
+    return true;
+}
+
+int bdpt_integrator::camera_subpath(const ray& r, bdpt_vertex* path, color& escaped) const
+{
+    bdpt_vertex& v = path[0];
+    v = bdpt_vertex();
+    v.kind = bdpt_vertex::camera_end;
+    v.p = r.origin();
+    v.normal = forward;
+    v.beta = color(1, 1, 1);
+    v.pdf_fwd = 1;
+
+    auto cos_theta = dot(unit_vector(r.direction()), forward);
+    return random_walk(r, v.beta, importance(cos_theta), path, max_depth + 2, &escaped);
+}
+
+int bdpt_integrator::light_subpath(real time, bdpt_vertex* path) const
+{
+    if (lights.empty())
+        return 0;
+
+    auto index = lights.pick(random_double());
+    surface_sample s;
+    if (!lights.lights[index]->sample_point(s))
+        return 0;
+
+    onb uvw;
+    uvw.build_from_w(s.normal);
+    auto local = random_cosine_direction();
+    ray r(s.p, uvw.local(local), time);
+
+    bdpt_vertex& v = path[0];
+    v = bdpt_vertex();
+    v.kind = bdpt_vertex::light_end;
+    v.p = s.p;
+    v.normal = s.normal;
+    v.rec.mat_id = s.mat_id;
+    v.pdf_fwd = lights.select_pdf[index] * s.area_pdf;
+    v.beta = sampled_emission(s) / v.pdf_fwd;
+
+    // ҷֲķܶ cos / У뷢
+    return random_walk(r, v.beta * pi, local.z() / pi, path, max_depth + 1, nullptr);
+}
+
+//  path[0] ׷٣·Ķ·ʱ escaped Ϊʱ beta
+int bdpt_integrator::random_walk(ray r, color start, real pdf_dir, bdpt_vertex* path, int max_vertices, color* escaped) const
+{
+    color beta = start;
+    color throughput(1, 1, 1);      // ĹףԴ·㺬йԴĹʣ˹̰
+    int k = 1;
+    while (k < max_vertices)
+    {
+        hit_record rec;
+        if (!world.hit(r, 0.001, infinity, rec))
+        {
+            if (escaped)
+                *escaped = beta;
+            break;
+        }
+        rec.resolve(r);
+
+        bdpt_vertex& prev = path[k - 1];
+        bdpt_vertex& v = path[k];
+        v = bdpt_vertex();
+        v.p = rec.p;
+        v.normal = rec.normal;
+        v.rec = rec;
+        v.r_in = r;
+        v.beta = beta;
+        v.pdf_fwd = convert_density(pdf_dir, prev, v);
+        k++;
+
+        const material& mat = current_scene().mat(rec.mat_id);
+        scatter_record srec;
+        if (!mat.scatter(r, rec, srec))
+        {
+            v.emissive = true;
+            break;
+        }
+        v.attenuation = srec.attenuation;
+        if (k >= max_vertices)
+            break;
+
+        ray next;
+        real pdf_rev;
+        if (srec.is_specular)
+        {
+            v.delta = true;
+            next = srec.specular_ray;
+            throughput = throughput * srec.attenuation;
+            pdf_dir = pdf_rev = 0;
+        }
+        else
+        {
+            next = ray(rec.p, srec.surface_pdf.generate(), r.time());
+            pdf_dir = srec.surface_pdf.value(next.direction());
+            if (!(pdf_dir > 0))
+                break;
+            throughput = throughput * srec.attenuation * mat.scattering_pdf(r, rec, next) / pdf_dir;
+            // 򣺹 next ķ򵽴ɢ r 
+            pdf_rev = mat.sampling_pdf(ray(next.at(1), -next.direction(), r.time()), rec, -r.direction());
+        }
+        prev.pdf_rev = convert_density(pdf_rev, v, prev);
+
+        if (k - 1 >= rr_min_depth)
+        {
+            auto survive = ffmin(ffmax(throughput.x(), ffmax(throughput.y(), throughput.z())), real(0.95));
+            if (!(random_double() < survive))
+                break;
+            throughput /= survive;
+        }
+        beta = start * throughput;
+        r = next;
+    }
+    return k;
+}
+
+real bdpt_integrator::pdf(const bdpt_vertex& v, const bdpt_vertex& next, const bdpt_vertex* from) const
+{
+    if (v.kind == bdpt_vertex::light_end)
+        return pdf_light(v, next);
+
+    real pdf_dir;
+    if (v.kind == bdpt_vertex::camera_end)
+    {
+        int pixel;
+        real cos_theta;
+        if (!project(next.p, pixel, cos_theta))
+            return 0;
+        pdf_dir = importance(cos_theta);
+    }
+    else
+    {
+        ray r_in = from ? ray(from->p, v.p - from->p, v.r_in.time()) : v.r_in;
+        pdf_dir = current_scene().mat(v.rec.mat_id).sampling_pdf(r_in, v.rec, next.p - v.p);
+    }
+    return convert_density(pdf_dir, v, next);
+}
+
+real bdpt_integrator::pdf_light(const bdpt_vertex& v, const bdpt_vertex& next) const
+{
+    auto w = unit_vector(next.p - v.p);
+    return convert_density(ffmax(dot(v.normal, w), 0) / pi, v, next);
+}
+
+color bdpt_integrator::connect(bdpt_vertex* light_path, bdpt_vertex* camera_path, int s, int t, real time, int& pixel, long long& shadows) const
+{
+    color L(0, 0, 0);
+    bdpt_vertex sampled;
+    const bdpt_vertex& pt = camera_path[t - 1];
+
+    if (s == 0)
+    {
+        // ·Լ˹Դ
+        if (!pt.emissive)
+            return L;
+        L = pt.beta * current_scene().mat(pt.rec.mat_id).emitted(pt.r_in, pt.rec, pt.rec.u, pt.rec.v, pt.p);
+    }
+    else if (t == 1)
+    {
+        // Դ·Ķֱ
+        const bdpt_vertex& qs = light_path[s - 1];
+        real cos_camera;
+        if (!qs.connectible() || !project(qs.p, pixel, cos_camera))
+            return L;
+        auto w = pt.p - qs.p;
+        auto f = brdf(qs, w);
+        if (f.length_squared() == 0 || !visible(qs.p, pt.p, time, shadows))
+            return L;
+        L = qs.beta * f * (fabs(dot(qs.normal, w)) / (w.length() * w.length_squared()) * importance(cos_camera));
+    }
+    else if (s == 1)
+    {
+        // ڹԴȡһ·ѭֱӹղͬ
+        if (!pt.connectible() || lights.empty())
+            return L;
+        auto index = lights.pick(random_double());
+        surface_sample ls;
+        if (!lights.lights[index]->sample_point(ls))
+            return L;
+
+        auto w = ls.p - pt.p;
+        auto dist2 = w.length_squared();
+        auto cos_light = -dot(ls.normal, w) / sqrt(dist2);
+        if (!(cos_light > 0))
+            return L;
+        auto f = brdf(pt, w);
+        if (f.length_squared() == 0 || !visible(pt.p, ls.p, time, shadows))
+            return L;
+
+        sampled.kind = bdpt_vertex::light_end;
+        sampled.p = ls.p;
+        sampled.normal = ls.normal;
+        sampled.rec.mat_id = ls.mat_id;
+        sampled.pdf_fwd = lights.select_pdf[index] * ls.area_pdf;
+        auto le = sampled_emission(ls);
+        L = pt.beta * f * le * (fabs(dot(pt.normal, w)) / sqrt(dist2) * cos_light / dist2 / sampled.pdf_fwd);
+    }
+    else
+    {
+        const bdpt_vertex& qs = light_path[s - 1];
+        if (!qs.connectible() || !pt.connectible())
+            return L;
+        auto w = pt.p - qs.p;
+        auto dist2 = w.length_squared();
+        auto fq = brdf(qs, w);
+        auto fp = brdf(pt, -w);
+        if (fq.length_squared() == 0 || fp.length_squared() == 0)
+            return L;
+        auto g = fabs(dot(qs.normal, w)) * fabs(dot(pt.normal, w)) / (dist2 * dist2);
+        if (!visible(qs.p, pt.p, time, shadows))
+            return L;
+        L = qs.beta * fq * fp * pt.beta * g;
+    }
+
+    if (L.x() <= 0 && L.y() <= 0 && L.z() <= 0)
+        return L;
+    return L * mis_weight(light_path, camera_path, sampled, s, t);
+}
+
+// ƽʽ· (s, t) ɵܶ (s', t') ɵ֮ܶȵĺ͡
+// Ӵΰһ㻻һ·ֵÿγ pdf_rev / pdf_fwd
+// ܶΪ 0棩ļǳ 1 ˣ涥Ӳڣ
+real bdpt_integrator::mis_weight(bdpt_vertex* light_path, bdpt_vertex* camera_path, const bdpt_vertex& sampled, int s, int t) const
+{
+    if (s + t == 2)
+        return 1;
+
+    // s = 1 ʱԴ·㻻ȡĹԴ㣻ӴܶȺ;ʱĵָ
+    bdpt_vertex saved_origin;
+    if (s == 1)
+    {
+        saved_origin = light_path[0];
+        light_path[0] = sampled;
+    }
+
+    bdpt_vertex* qs = s > 0 ? &light_path[s - 1] : nullptr;
+    bdpt_vertex* pt = &camera_path[t - 1];
+    bdpt_vertex* qs_minus = s > 1 ? &light_path[s - 2] : nullptr;
+    bdpt_vertex* pt_minus = t > 1 ? &camera_path[t - 2] : nullptr;
+
+    real saved_pt = pt->pdf_rev;
+    real saved_pt_minus = pt_minus ? pt_minus->pdf_rev : 0;
+    real saved_qs = qs ? qs->pdf_rev : 0;
+    real saved_qs_minus = qs_minus ? qs_minus->pdf_rev : 0;
+    bool saved_pt_delta = pt->delta;
+    bool saved_qs_delta = qs ? qs->delta : false;
+
+    pt->delta = false;
+    if (qs)
+        qs->delta = false;
+    pt->pdf_rev = s > 0 ? pdf(*qs, *pt) : pdf_light_origin(*pt);
+    if (pt_minus)
+        pt_minus->pdf_rev = s > 0 ? pdf(*pt, *pt_minus, qs) : pdf_light(*pt, *pt_minus);
+    if (qs)
+        qs->pdf_rev = pdf(*pt, *qs);
+    if (qs_minus)
+        qs_minus->pdf_rev = pdf(*qs, *qs_minus, pt);
+
+    auto remap0 = [](real f) { return f != 0 ? f : real(1); };
+    real sum = 0;
+    real ri = 1;
+    for (int i = t - 1; i > 0; i--)
+    {
+        ri *= remap0(camera_path[i].pdf_rev) / remap0(camera_path[i].pdf_fwd);
+        if (!camera_path[i].delta && !camera_path[i - 1].delta)
+            sum += ri;
+    }
+    ri = 1;
+    for (int i = s - 1; i >= 0; i--)
+    {
+        ri *= remap0(light_path[i].pdf_rev) / remap0(light_path[i].pdf_fwd);
+        bool delta_before = i > 0 && light_path[i - 1].delta;
+        if (!light_path[i].delta && !delta_before)
+            sum += ri;
+    }
+
+    pt->pdf_rev = saved_pt;
+    if (pt_minus)
+        pt_minus->pdf_rev = saved_pt_minus;
+    if (qs)
+        qs->pdf_rev = saved_qs;
+    if (qs_minus)
+        qs_minus->pdf_rev = saved_qs_minus;
+    pt->delta = saved_pt_delta;
+    if (qs)
+        qs->delta = saved_qs_delta;
+    if (s == 1)
+        light_path[0] = saved_origin;
+
+    return 1 / (1 + sum);
+}
+
+#endif
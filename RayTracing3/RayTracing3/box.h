@@ -2,7 +2,6 @@
 #define BOX_H
 
 #include "rtweekend.h"
-#include "hittable_list.h"
 #include "aarect.h"
 
 // 
@@ -12,18 +11,24 @@ public:
     box() {}
     box(const vec3& p0, const vec3& p1, shared_ptr<material> ptr);
 
-    virtual bool hit(const ray& r, double t0, double t1, hit_record& rec) const;
+    virtual bool hit(const ray& r, real t0, real t1, hit_record& rec) const;
 
-    virtual bool bounding_box(double t0, double t1, aabb& output_box) const
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const
     {
         output_box = aabb(box_min, box_max);
         return true;
     }
 
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const override;
+    virtual void compile(scene_storage& scene) override;
+
 public:
     vec3 box_min;
     vec3 box_max;
-    hittable_list sides;
+    // 水ֵڲٵѷ䣬ҲҪ hittable_list
+    xy_rect xy_sides[2];
+    xz_rect xz_sides[2];
+    yz_rect yz_sides[2];
 };
 
 box::box(const vec3& p0, const vec3& p1, shared_ptr<material> ptr) 
@@ -31,19 +36,69 @@ box::box(const vec3& p0, const vec3& p1, shared_ptr<material> ptr)
     box_min = p0;
     box_max = p1;
 
-    sides.add(make_shared<xy_rect>(p0.x(), p1.x(), p0.y(), p1.y(), p1.z(), ptr));
-    sides.add(make_shared<xy_rect>(p0.x(), p1.x(), p0.y(), p1.y(), p0.z(), ptr));
+    xy_sides[0] = xy_rect(p0.x(), p1.x(), p0.y(), p1.y(), p1.z(), ptr);
+    xy_sides[1] = xy_rect(p0.x(), p1.x(), p0.y(), p1.y(), p0.z(), ptr);
+
+    xz_sides[0] = xz_rect(p0.x(), p1.x(), p0.z(), p1.z(), p1.y(), ptr);
+    xz_sides[1] = xz_rect(p0.x(), p1.x(), p0.z(), p1.z(), p0.y(), ptr);
+
+    yz_sides[0] = yz_rect(p0.y(), p1.y(), p0.z(), p1.z(), p1.x(), ptr);
+    yz_sides[1] = yz_rect(p0.y(), p1.y(), p0.z(), p1.z(), p0.x(), ptr);
+}
 
-    sides.add(make_shared<xz_rect>(p0.x(), p1.x(), p0.z(), p1.z(), p1.y(), ptr));
-    sides.add(make_shared<xz_rect>(p0.x(), p1.x(), p0.z(), p1.z(), p0.y(), ptr));
+// 尴ֱ水ֵţ干Ȩ shared_ptr ָ
+void box::collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const
+{
+    for (const auto& side : xy_sides)
+        side.collect_lights(shared_ptr<hittable>(self, const_cast<xy_rect*>(&side)), lights);
+    for (const auto& side : xz_sides)
+        side.collect_lights(shared_ptr<hittable>(self, const_cast<xz_rect*>(&side)), lights);
+    for (const auto& side : yz_sides)
+        side.collect_lights(shared_ptr<hittable>(self, const_cast<yz_rect*>(&side)), lights);
+}
 
-    sides.add(make_shared<yz_rect>(p0.y(), p1.y(), p0.z(), p1.z(), p1.x(), ptr));
-    sides.add(make_shared<yz_rect>(p0.y(), p1.y(), p0.z(), p1.z(), p0.x(), ptr));
+void box::compile(scene_storage& scene)
+{
+    for (auto& side : xy_sides)
+        side.compile(scene);
+    for (auto& side : xz_sides)
+        side.compile(scene);
+    for (auto& side : yz_sides)
+        side.compile(scene);
 }
 
-bool box::hit(const ray& r, double t0, double t1, hit_record& rec) const
+// 󽻣ȡĽ㣨ֱӵ÷麯
+bool box::hit(const ray& r, real t0, real t1, hit_record& rec) const
 {
-    return sides.hit(r, t0, t1, rec);
+    bool hit_anything = false;
+    auto closest_so_far = t1;
+
+    for (const auto& side : xy_sides)
+    {
+        if (side.xy_rect::hit(r, t0, closest_so_far, rec))
+        {
+            hit_anything = true;
+            closest_so_far = rec.t;
+        }
+    }
+    for (const auto& side : xz_sides)
+    {
+        if (side.xz_rect::hit(r, t0, closest_so_far, rec))
+        {
+            hit_anything = true;
+            closest_so_far = rec.t;
+        }
+    }
+    for (const auto& side : yz_sides)
+    {
+        if (side.yz_rect::hit(r, t0, closest_so_far, rec))
+        {
+            hit_anything = true;
+            closest_so_far = rec.t;
+        }
+    }
+
+    return hit_anything;
 }
 
 #endif 
@@ -3,6 +3,10 @@
 #include <algorithm>
 #include "rtweekend.h"
 #include "hittable_list.h"
+#include "typed_list.h"
+
+// ҶӽڵɵҶڲͷ
+const size_t bvh_leaf_size = 4;
 
 
 // ΰΧ
@@ -11,16 +15,31 @@ class bvh_node : public hittable
 public:
     bvh_node();
 
-    bvh_node(hittable_list& list, double time0, double time1)
+    bvh_node(hittable_list& list, real time0, real time1)
         : bvh_node(list.objects, 0, list.objects.size(), time0, time1)
     {}
 
     bvh_node(
         std::vector<shared_ptr<hittable>>& objects,
-        size_t start, size_t end, double time0, double time1);
+        size_t start, size_t end, real time0, real time1);
+
+    virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const;
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const;
+    virtual unsigned hit_packet(const ray_packet& rp, real t_min, real* t_max, hit_record* recs, unsigned active) const;
 
-    virtual bool hit(const ray& r, double tmin, double tmax, hit_record& rec) const;
-    virtual bool bounding_box(double t0, double t1, aabb& output_box) const;
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const
+    {
+        left->collect_lights(left, lights);
+        if (right != left)
+            right->collect_lights(right, lights);
+    }
+
+    virtual void compile(scene_storage& scene) override
+    {
+        left->compile(scene);
+        if (right != left)
+            right->compile(scene);
+    }
 
 public:
     shared_ptr<hittable> left;
@@ -55,7 +74,7 @@ bool box_z_compare(const shared_ptr<hittable> a, const shared_ptr<hittable> b) {
 // 3. ԰, ÿһ
 bvh_node::bvh_node(
     std::vector<shared_ptr<hittable>>& objects,
-    size_t start, size_t end, double time0, double time1)
+    size_t start, size_t end, real time0, real time1)
 {
     int axis = random_int(0, 2);
     auto comparator = (axis == 0) ? box_x_compare
@@ -64,7 +83,11 @@ bvh_node::bvh_node(
 
     size_t object_span = end - start;
 
-    if (object_span == 1) 
+    if (object_span > 1 && object_span <= bvh_leaf_size)
+    {
+        left = right = arena_make<typed_list>(objects, start, end);
+    }
+    else if (object_span == 1) 
     {
         left = right = objects[start];
     }
@@ -86,8 +109,8 @@ bvh_node::bvh_node(
         std::sort(objects.begin() + start, objects.begin() + end, comparator);
 
         auto mid = start + object_span / 2;
-        left = make_shared<bvh_node>(objects, start, mid, time0, time1);
-        right = make_shared<bvh_node>(objects, mid, end, time0, time1);
+        left = arena_make<bvh_node>(objects, start, mid, time0, time1);
+        right = arena_make<bvh_node>(objects, mid, end, time0, time1);
     }
 
     aabb box_left, box_right;
@@ -100,18 +123,31 @@ bvh_node::bvh_node(
 
 // ڵboxǷ񱻻, ǵĻ, ǾͶڵӽڵжϡ
 // ݹ
-bool bvh_node::hit(const ray& r, double t_min, double t_max, hit_record& rec) const 
+bool bvh_node::hit(const ray& r, real t_min, real t_max, hit_record& rec) const 
 {
     if (!box.hit(r, t_min, t_max))
         return false;
 
     bool hit_left = left->hit(r, t_min, t_max, rec);
-    bool hit_right = right->hit(r, t_min, hit_left ? rec.t : t_max, rec);
+    bool hit_right = right != left && right->hit(r, t_min, hit_left ? rec.t : t_max, rec);
 
     return hit_left || hit_right;
 }
 
-bool bvh_node::bounding_box(double t0, double t1, aabb& output_box) const 
+// ߰һνڵԣֻȻаΧеĹ߼
+unsigned bvh_node::hit_packet(const ray_packet& rp, real t_min, real* t_max, hit_record* recs, unsigned active) const
+{
+    active = box.hit_packet(rp, t_min, t_max, active);
+    if (!active)
+        return 0;
+
+    unsigned hit_left = left->hit_packet(rp, t_min, t_max, recs, active);
+    unsigned hit_right = right != left ? right->hit_packet(rp, t_min, t_max, recs, active) : 0;
+
+    return hit_left | hit_right;
+}
+
+bool bvh_node::bounding_box(real t0, real t1, aabb& output_box) const 
 {
     output_box = box;
     return true;
@@ -3,14 +3,22 @@
 
 #include "rtweekend.h"
 
+// άڵλԲȡ㣺ӳ䣬 random_in_unit_disk ܾ
+inline vec3 sample_unit_disk()
+{
+    auto r = sqrt(sample_1d(sample_dim::lens_u));
+    auto phi = 2 * pi * sample_1d(sample_dim::lens_v);
+    return vec3(r * cos(phi), r * sin(phi), 0);
+}
+
 class camera {
 public:
     camera(
         vec3 lookfrom, vec3 lookat, vec3 vup,
-        double vfov,                            
-        double aspect,
-        double aperture, double focus_dist,      // ׾ͽ
-        double t0 = 0.0, double t1 = 0.0
+        real vfov,                            
+        real aspect,
+        real aperture, real focus_dist,      // ׾ͽ
+        real t0 = 0.0, real t1 = 0.0
     ) 
     {
         origin = lookfrom;
@@ -33,14 +41,15 @@ public:
         vertical = 2 * half_height * focus_dist * v;
     }
 
-    ray get_ray(double s, double t) 
+    ray get_ray(real s, real t) 
     {
-        vec3 rd = lens_radius * random_in_unit_disk();
+        // ʹõͲʱͷλɹ̶άȾ
+        vec3 rd = lens_radius * (active_sampler() ? sample_unit_disk() : random_in_unit_disk());
         vec3 offset = u * rd.x() + v * rd.y();
         return ray(
             origin + offset,
             lower_left_corner + s * horizontal + t * vertical - origin - offset,
-            random_double(time0, time1)
+            sample_1d(sample_dim::time, time0, time1)
         );
     }
 
@@ -50,7 +59,7 @@ public:
     vec3 horizontal;
     vec3 vertical;
     vec3 u, v, w;               // xyz
-    double lens_radius;         // ׾(Ȧ)İ뾶
-    double time0, time1;        // ŵĿʼ/ʱ
+    real lens_radius;         // ׾(Ȧ)İ뾶
+    real time0, time1;        // ŵĿʼ/ʱ
 };
 #endif
\ No newline at end of file
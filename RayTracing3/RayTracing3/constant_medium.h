@@ -10,31 +10,36 @@
 class constant_medium : public hittable
 {
 public:
-	constant_medium(shared_ptr<hittable> b, double d, shared_ptr<texture> a)
-		: boundary(b), neg_inv_density(-1/d),
-		  phase_function(make_shared<isotropic>(a))
+	constant_medium(shared_ptr<hittable> b, real d, shared_ptr<texture> a)
+		: boundary(b), phase_function(arena_make<isotropic>(a)), neg_inv_density(-1/d)
 	{}
 
-	constant_medium(shared_ptr<hittable> b, double d, vec3 a)
-		: boundary(b), neg_inv_density(-1 / d),
-		phase_function(make_shared<isotropic>(a))
+	constant_medium(shared_ptr<hittable> b, real d, vec3 a)
+		: boundary(b), phase_function(arena_make<isotropic>(a)), neg_inv_density(-1 / d)
 	{}
 
-	virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const;
+	virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const;
 
-	virtual bool bounding_box(double time0, double time1, aabb& output_box) const
+	virtual bool bounding_box(real time0, real time1, aabb& output_box) const
 	{
 		return boundary->bounding_box(time0, time1, output_box);
 	}
 
+	// ֻ߽ tĲòֻǼλ
+	virtual void compile(scene_storage& scene) override
+	{
+		phase_id = scene.add_material(phase_function);
+	}
+
 public:
 	shared_ptr<hittable> boundary;			// ߽
 	shared_ptr<material> phase_function;	// λ
-	double neg_inv_density;					// ܶ
+	uint32_t phase_id = 0;					// λĲ±꣬compile ֮Ч
+	real neg_inv_density;					// ܶ
 
 };
 
-bool constant_medium::hit(const ray& r, double t_min, double t_max, hit_record& rec) const
+bool constant_medium::hit(const ray& r, real t_min, real t_max, hit_record& rec) const
 {
 	// ԴӡҪþͰenableDebugΪtrue
 	const bool enableDebug = false;
@@ -76,7 +81,8 @@ bool constant_medium::hit(const ray& r, double t_min, double t_max, hit_record&
 
 	rec.normal = vec3(1, 0, 0);		// 
 	rec.front_face = true;			// 
-	rec.mat_ptr = phase_function;
+	rec.mat_id = phase_id;
+	rec.object = nullptr;			// Ѿȫ
 
 	return true;
 }
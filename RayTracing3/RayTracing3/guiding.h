@@ -0,0 +1,335 @@
+#ifndef GUIDING_H
+#define GUIDING_H
+
+#include <vector>
+#include "rtweekend.h"
+#include "aabb.h"
+#include "pdf.h"
+
+// ·Muller et al. 2017, "Practical Path Guiding for Efficient Light-Transport Simulation"
+// ռһ kd S-treeֳΧУÿҶһ÷ĲD-tree
+// ¼ƬȰķֲȾֳѵÿһһѧķֲ
+// ͬʱ·ÿõȼ¼µһֽϸĿռҶӣ
+// ϸֻϲĲĽڵ㡣䶥㰴ѧķֲ BSDF ֮ѡɢ䷽
+// ԭĲͬɫ㰴ߵ᷽򣨡xyzֵ 6 ÿռѧķֲ BSDF
+// ǽǴذǽڹһҶʱһ䵽汳棬ȫ˷
+
+//  <-> λΣӳ䣬cos(theta)  phi ռһάſɱΪ 4
+inline vec3 square_to_direction(real u, real v)
+{
+    auto cos_theta = 2 * u - 1;
+    auto sin_theta = sqrt(ffmax(0, 1 - cos_theta * cos_theta));
+    auto phi = 2 * pi * v;
+    return vec3(sin_theta * cos(phi), sin_theta * sin(phi), cos_theta);
+}
+
+inline void direction_to_square(const vec3& d, real& u, real& v)
+{
+    auto w = unit_vector(d);
+    u = clamp((w.z() + 1) / 2, 0, real(0.99999994));
+    auto phi = atan2(w.y(), w.x());
+    v = (phi < 0 ? phi + 2 * pi : phi) / (2 * pi);
+    v = clamp(v, 0, real(0.99999994));
+}
+
+// Ĳÿڵ㸲ǵλεһ飬sum[i] ǵ i ӿ飨x λΪ i & 1y λΪ i >> 1
+class dtree
+{
+public:
+    dtree() { nodes.push_back(node()); }
+
+    real total() const { return nodes[0].sum[0] + nodes[0].sum[1] + nodes[0].sum[2] + nodes[0].sum[3]; }
+
+    // ڷ d ۼ weight
+    void record(const vec3& d, real weight)
+    {
+        real u, v;
+        direction_to_square(d, u, v);
+        int index = 0;
+        while (true)
+        {
+            auto q = quadrant(u, v);
+            nodes[index].sum[q] += weight;
+            if (nodes[index].child[q] == 0)
+                return;
+            index = nodes[index].child[q];
+        }
+    }
+
+    // ϵĸܶ
+    real pdf(const vec3& d) const
+    {
+        real u, v;
+        direction_to_square(d, u, v);
+        real density = 1;
+        int index = 0;
+        while (true)
+        {
+            const node& n = nodes[index];
+            auto sum = n.sum[0] + n.sum[1] + n.sum[2] + n.sum[3];
+            if (!(sum > 0))
+                break;
+            auto q = quadrant(u, v);
+            density *= 4 * n.sum[q] / sum;
+            if (n.child[q] == 0 || density == 0)
+                break;
+            index = n.child[q];
+        }
+        return density / (4 * pi);
+    }
+
+    // Ȱеѡ xһﰴµѡ yάķֲ㱣Ҷ
+    vec3 sample(real u, real v) const
+    {
+        real x = 0, y = 0, size = 1;
+        int index = 0;
+        while (true)
+        {
+            const node& n = nodes[index];
+            auto sum = n.sum[0] + n.sum[1] + n.sum[2] + n.sum[3];
+            if (!(sum > 0))
+                break;
+
+            int xbit = pick((n.sum[0] + n.sum[2]) / sum, u);
+            int ybit = pick(n.sum[xbit] + n.sum[xbit + 2] > 0 ? n.sum[xbit] / (n.sum[xbit] + n.sum[xbit + 2]) : real(0.5), v);
+            int q = xbit | ybit << 1;
+
+            size /= 2;
+            x += xbit * size;
+            y += ybit * size;
+            if (n.child[q] == 0)
+                break;
+            index = n.child[q];
+        }
+        return square_to_direction(x + u * size, y + v * size);
+    }
+
+    // һһּ¼ķֲ»֣ռȳ threshold Ŀϸ֣
+    // ĺϲҶӡ㣬¼һ
+    void refine_from(const dtree& src, real threshold, int max_depth)
+    {
+        nodes.assign(1, node());
+        auto total_energy = src.total();
+        if (!(total_energy > 0))
+            return;
+        build(src, 0, 0, 0, threshold * total_energy, 1, max_depth);
+    }
+
+    size_t size() const { return nodes.size(); }
+
+private:
+    struct node
+    {
+        real sum[4] = { 0, 0, 0, 0 };
+        int child[4] = { 0, 0, 0, 0 };     // 0 ʾӿҶӣڵ㲻κνڵĺӣ
+    };
+
+    //  (u, v) ڵӿ껻㵽ӿڲ
+    static int quadrant(real& u, real& v)
+    {
+        int xbit = u >= real(0.5);
+        int ybit = v >= real(0.5);
+        u = 2 * u - xbit;
+        v = 2 * v - ybit;
+        return xbit | ybit << 1;
+    }
+
+    // Ը p ȡ 0 u ӳ [0,1)
+    static int pick(real p, real& u)
+    {
+        if (u < p)
+        {
+            u = u / p;
+            return 0;
+        }
+        u = ffmin((u - p) / (1 - p), real(0.99999994));
+        return 1;
+    }
+
+    // src_index Ϊ -1 ʾԴѾҶӣĸӿȷֲÿΪ leaf_energy
+    void build(const dtree& src, int dst_index, int src_index, real leaf_energy, real split_energy, int depth, int max_depth)
+    {
+        for (int q = 0; q < 4; q++)
+        {
+            auto energy = src_index >= 0 ? src.nodes[src_index].sum[q] : leaf_energy;
+            if (!(energy > split_energy) || depth >= max_depth)
+                continue;
+
+            int src_child = src_index >= 0 && src.nodes[src_index].child[q] != 0 ? src.nodes[src_index].child[q] : -1;
+            int child = static_cast<int>(nodes.size());
+            nodes.push_back(node());
+            nodes[dst_index].child[q] = child;
+            build(src, child, src_child, energy / 4, split_energy, depth + 1, max_depth);
+        }
+    }
+
+    std::vector<node> nodes;
+};
+
+// һƬռֲsampling һѧġķֲbuilding ¼һֵ
+struct guide_leaf
+{
+    dtree sampling;
+    dtree building;
+    long long records = 0;
+};
+
+// ռ kd  + Ĳ߷ֳ 6 ÿռnodes ǰ 6 ǵĸ
+class path_guide
+{
+public:
+    path_guide(const aabb& bounds)
+    {
+        // 壬Ƚ xyz ԰
+        auto size = bounds.max() - bounds.min();
+        auto extent = ffmax(size.x(), ffmax(size.y(), size.z())) * real(1.001) + real(1e-3);
+        origin = bounds.min() - vec3(1, 1, 1) * (extent * real(0.0005));
+        scale = 1 / extent;
+
+        for (int i = 0; i < 6; i++)
+        {
+            nodes.push_back(snode());
+            leaves.push_back(guide_leaf());
+            nodes[i].leaf = i;
+        }
+    }
+
+    // Ϊ n ɫ p ڵĿռҶ
+    guide_leaf& leaf_at(const point3& p, const vec3& n)
+    {
+        auto q = (p - origin) * scale;
+        real c[3] = { clamp(q.x(), 0, 1), clamp(q.y(), 0, 1), clamp(q.z(), 0, 1) };
+
+        int major = 0;
+        if (fabs(n.y()) > fabs(n[major]))
+            major = 1;
+        if (fabs(n.z()) > fabs(n[major]))
+            major = 2;
+        int index = 2 * major + (n[major] < 0);
+        int axis = 0;
+        while (nodes[index].leaf < 0)
+        {
+            int side = c[axis] >= real(0.5);
+            c[axis] = 2 * c[axis] - side;
+            index = nodes[index].child[side];
+            axis = (axis + 1) % 3;
+        }
+        return leaves[nodes[index].leaf];
+    }
+
+    // ڵĿռҶ leaf  d ȹΪ radianceĲܶΪ pdf
+    void record(guide_leaf& leaf, const vec3& d, real radiance, real pdf)
+    {
+        leaf.records++;
+        if (radiance > 0 && pdf > 0)
+            leaf.building.record(d, radiance / pdf);
+    }
+
+    // һѵ iteration ֣ 0 ʼ֮󣬼¼ spatial_threshold * sqrt(2^iteration)
+    // ĿռҶһΪһֵؽ
+    void refine(int iteration)
+    {
+        auto threshold = spatial_threshold * sqrt(real(1 << iteration));
+        for (size_t i = 0; i < nodes.size(); i++)
+            split(static_cast<int>(i), threshold);
+
+        for (auto& leaf : leaves)
+        {
+            leaf.sampling = leaf.building;
+            leaf.building.refine_from(leaf.sampling, directional_threshold, max_directional_depth);
+            leaf.records = 0;
+        }
+    }
+
+    size_t spatial_leaves() const { return leaves.size(); }
+
+public:
+    real spatial_threshold = 12000;     // ռҶϸҪļ¼ sqrt(2^k) 
+    real directional_threshold = 0.01;  // ڵռȳϸ
+    int max_directional_depth = 20;
+    bool training = true;               // Ϊ false ʱֻѧķֲټ¼
+
+private:
+    struct snode
+    {
+        int child[2] = { 0, 0 };
+        int leaf = -1;              // Ҷ leaves ±꣬ڲڵΪ -1
+    };
+
+    // ӽڵ̳иڵ÷һļ¼ϸֱֵ
+    void split(int index, real threshold)
+    {
+        if (nodes[index].leaf < 0 || leaves[nodes[index].leaf].records <= threshold)
+            return;
+
+        int leaf = nodes[index].leaf;
+        leaves[leaf].records /= 2;
+        int second = static_cast<int>(leaves.size());
+        leaves.push_back(leaves[leaf]);
+
+        int a = static_cast<int>(nodes.size());
+        nodes.push_back(snode());
+        nodes.push_back(snode());
+        nodes[a].leaf = leaf;
+        nodes[a + 1].leaf = second;
+        nodes[index].leaf = -1;
+        nodes[index].child[0] = a;
+        nodes[index].child[1] = a + 1;
+
+        split(a, threshold);
+        split(a + 1, threshold);
+    }
+
+    std::vector<snode> nodes;
+    std::vector<guide_leaf> leaves;
+    point3 origin;
+    real scale;
+};
+
+// ѵʱ·ϵһ䶥㡣throughput ɢ֮֮ۼӵ·ϵĹ c
+// Ӧ direction  c / throughput
+struct guide_vertex
+{
+    guide_leaf* leaf;
+    vec3 direction;
+    real pdf;
+    color throughput;
+    color radiance;
+    int bounce;
+
+    void add(const color& c)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            if (throughput[i] > 0)
+                radiance[i] += c[i] / throughput[i];
+        }
+    }
+};
+
+// 䶥ɢֲ fraction ĸʰѧķֲ BSDF 
+//  mixture_pdf һָֻ룬ջʹãtree Ϊ nullptr ʱʹ
+class guided_pdf : public pdf
+{
+public:
+    guided_pdf(const dtree* d, const pdf& b, real f) : tree(d), bsdf(&b), fraction(f) {}
+
+    virtual real value(const vec3& direction) const override
+    {
+        return fraction * tree->pdf(direction) + (1 - fraction) * bsdf->value(direction);
+    }
+
+    virtual vec3 generate() const override
+    {
+        if (sample_1d(sample_dim::bounce_choice) < fraction)
+            return tree->sample(sample_1d(sample_dim::bounce_u), sample_1d(sample_dim::bounce_v));
+        return bsdf->generate();
+    }
+
+public:
+    const dtree* tree;
+    const pdf* bsdf;
+    real fraction;
+};
+
+#endif
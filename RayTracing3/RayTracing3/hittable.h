@@ -1,21 +1,34 @@
 #ifndef HITTABLE_H
 #define HITTABLE_H
 
+#include <vector>
 #include "rtweekend.h"
 #include "aabb.h"
+#include "scene.h"
 
 class material;
+class hittable;
+
+// Ƿ񷢹⣨diffuse_lightԼԷȣ material.h
+inline bool emits_light(uint32_t mat_id);
+inline real emitted_luminance(uint32_t mat_id);
 
 // кϢ¼
+// ʱͼԪֻд t  objectԼֲݣߡuvʵ
+// ȷ֮ resolve һΣ滻ĺѡЩ
 struct hit_record 
 {
     vec3 p;                         // ߹ʽp(t) = a + tb
     vec3 normal;                    // 
-    shared_ptr<material> mat_ptr;   // ʵָ
-    double t;                       // ཻǸtֵ
-    double u;                       // uv
-    double v;
+    uint32_t mat_id;                // ڳе±
+    real t;                       // ཻǸtֵ
+    real u;                       // uv
+    real v;
     bool front_face;                // жϷ෽
+    const hittable* object = nullptr;   // δԵͼԪnullptr ʾѾȫ
+
+    //  pnormaluv
+    inline void resolve(const ray& r);
 
     // Զ÷䷽෴
     inline void set_face_normal(const ray& r, const vec3& outward_normal) 
@@ -25,13 +38,27 @@ struct hit_record
     }
 };
 
+// Դϵһ㣺һķߡꡢʺͰĸܶ
+struct surface_sample
+{
+    point3 p;
+    vec3 normal;
+    real u;
+    real v;
+    uint32_t mat_id;
+    real area_pdf;
+};
+
 // κο󽻵Ķʵʱ̳
 class hittable 
 {
 public:
-    virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const = 0;
-    virtual bool bounding_box(double t0, double t1, aabb& output_box) const = 0;            // Χ
-    virtual double pdf_value(const point3& o, const vec3& v) const
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const = 0;
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const = 0;            // Χ
+
+    // ӳټĽԣhit ֻ¼ t  object hit_record::resolve ﲹȫ
+    virtual void get_hit_attributes(const ray& r, hit_record& rec) const {}
+    virtual real pdf_value(const point3& o, const vec3& v) const
     {
         return 0.0;
     }
@@ -40,35 +67,114 @@ public:
     {
         return vec3(1, 0, 0);
     }
+
+    // ռĹԴself ָ shared_ptrܰǲķͼԪŽ lights
+    // ͱ任ҡĬʲôҲ
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const {}
+
+    // 볡֮Ⱦ֮ǰ world һΣͼԪԼĲʵǼǵ scene Ĳʱ
+    // ±깩ʱд hit_recordͱ任ҡĬʲôҲ
+    virtual void compile(scene_storage& scene) {}
+
+    // ΪԴʱ书ʵĹƣ *  * ԷȣѡԴʱʹ
+    virtual real light_power() const
+    {
+        return 0;
+    }
+
+    // ڱϰȵȡһ㣬ӹԴ׷ٹߣӣʱʹá֧ʱ false
+    virtual bool sample_point(surface_sample& s) const
+    {
+        return false;
+    }
+
+    // ߰󽻣active Ϊ󽻵Ĺ룬t_max  recs 
+    // ҵĹ롣Ĭ hitBVH бд
+    virtual unsigned hit_packet(const ray_packet& rp, real t_min, real* t_max, hit_record* recs, unsigned active) const
+    {
+        unsigned hits = 0;
+        for (int i = 0; i < packet_size; i++)
+        {
+            if ((active >> i & 1) && hit(rp.r[i], t_min, t_max[i], recs[i]))
+            {
+                t_max[i] = recs[i].t;
+                hits |= 1u << i;
+            }
+        }
+        return hits;
+    }
 };
 
+inline void hit_record::resolve(const ray& r)
+{
+    if (object == nullptr)
+        return;
+
+    auto o = object;
+    object = nullptr;
+    o->get_hit_attributes(r, *this);
+}
+
 // ƶ
 class translate : public hittable
 {
 public :
     translate(shared_ptr<hittable> p, const vec3& displacement) : ptr(p), offset(displacement) {}
 
-    virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const;
-    virtual bool bounding_box(double t0, double t1, aabb& output_box) const;
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const;
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const;
+
+    // ԴھֲռУƽӰ
+    virtual real pdf_value(const point3& o, const vec3& v) const override
+    {
+        return ptr->pdf_value(o - offset, v);
+    }
+
+    virtual vec3 random(const point3& o) const override
+    {
+        return ptr->random(o - offset);
+    }
+
+    virtual real light_power() const override
+    {
+        return ptr->light_power();
+    }
+
+    virtual bool sample_point(surface_sample& s) const override
+    {
+        if (!ptr->sample_point(s))
+            return false;
+        s.p += offset;
+        return true;
+    }
+
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const override;
+
+    virtual void compile(scene_storage& scene) override
+    {
+        ptr->compile(scene);
+    }
 
 public:
     shared_ptr<hittable> ptr;
     vec3 offset;
 };
 
-bool translate::hit(const ray& r, double t_min, double t_max, hit_record& rec) const 
+bool translate::hit(const ray& r, real t_min, real t_max, hit_record& rec) const 
 {
     ray moved_r(r.origin() - offset, r.direction(), r.time());
     if (!ptr->hit(moved_r, t_min, t_max, rec))
         return false;
 
+    // 任ҪĽԣھֲռȲȫٱ任
+    rec.resolve(moved_r);
     rec.p += offset;
     rec.set_face_normal(moved_r, rec.normal);
 
     return true;
 }
 
-bool translate::bounding_box(double t0, double t1, aabb& output_box) const 
+bool translate::bounding_box(real t0, real t1, aabb& output_box) const 
 {
     if (!ptr->bounding_box(t0, t1, output_box))
         return false;
@@ -80,28 +186,81 @@ bool translate::bounding_box(double t0, double t1, aabb& output_box) const
     return true;
 }
 
+// ÿԴͬƽƣ屾ǹԴʱֱԼ
+void translate::collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const
+{
+    std::vector<shared_ptr<hittable>> inner;
+    ptr->collect_lights(ptr, inner);
+    for (const auto& light : inner)
+        lights.push_back(light == ptr ? self : arena_make<translate>(light, offset));
+}
+
 //  y ת任
 class rotate_y : public hittable
 {
 public:
-    rotate_y(shared_ptr<hittable> p, double angle);
+    rotate_y(shared_ptr<hittable> p, real angle);
 
-    virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const;
-    virtual bool bounding_box(double t0, double t1, aabb& output_box) const
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const;
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const
     {
         output_box = bbox;
         return hasbox;
     }
 
+    virtual real pdf_value(const point3& o, const vec3& v) const override
+    {
+        return ptr->pdf_value(to_local(o), to_local(v));
+    }
+
+    virtual vec3 random(const point3& o) const override
+    {
+        return to_world(ptr->random(to_local(o)));
+    }
+
+    virtual real light_power() const override
+    {
+        return ptr->light_power();
+    }
+
+    // 任ıܶ
+    virtual bool sample_point(surface_sample& s) const override
+    {
+        if (!ptr->sample_point(s))
+            return false;
+        s.p = to_world(s.p);
+        s.normal = to_world(s.normal);
+        return true;
+    }
+
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const override;
+
+    virtual void compile(scene_storage& scene) override
+    {
+        ptr->compile(scene);
+    }
+
+private:
+    vec3 to_local(const vec3& v) const
+    {
+        return vec3(cos_theta * v.x() - sin_theta * v.z(), v.y(), sin_theta * v.x() + cos_theta * v.z());
+    }
+
+    vec3 to_world(const vec3& v) const
+    {
+        return vec3(cos_theta * v.x() + sin_theta * v.z(), v.y(), -sin_theta * v.x() + cos_theta * v.z());
+    }
+
 public:
     shared_ptr<hittable> ptr;
-    double sin_theta;
-    double cos_theta;
+    real angle;                 // Ƕȣ׵ĹԴʱ
+    real sin_theta;
+    real cos_theta;
     bool hasbox;
     aabb bbox;
 };
 
-rotate_y::rotate_y(shared_ptr<hittable> p, double angle) : ptr(p)
+rotate_y::rotate_y(shared_ptr<hittable> p, real angle) : ptr(p), angle(angle)
 {
     auto radians = degrees_to_radians(angle);
     sin_theta = sin(radians);
@@ -138,7 +297,7 @@ rotate_y::rotate_y(shared_ptr<hittable> p, double angle) : ptr(p)
     bbox = aabb(min, max);
 }
 
-bool rotate_y::hit(const ray& r, double t_min, double t_max, hit_record& rec) const 
+bool rotate_y::hit(const ray& r, real t_min, real t_max, hit_record& rec) const 
 {
     vec3 origin = r.origin();
     vec3 direction = r.direction();
@@ -154,6 +313,8 @@ bool rotate_y::hit(const ray& r, double t_min, double t_max, hit_record& rec) co
     if (!ptr->hit(rotated_r, t_min, t_max, rec))
         return false;
 
+    rec.resolve(rotated_r);
+
     vec3 p = rec.p;
     vec3 normal = rec.normal;
 
@@ -169,26 +330,72 @@ bool rotate_y::hit(const ray& r, double t_min, double t_max, hit_record& rec) co
     return true;
 }
 
+void rotate_y::collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const
+{
+    std::vector<shared_ptr<hittable>> inner;
+    ptr->collect_lights(ptr, inner);
+    for (const auto& light : inner)
+        lights.push_back(light == ptr ? self : arena_make<rotate_y>(light, angle));
+}
+
 // תƹ⣬ʹ䷨ָ -y 
 class flip_face : public hittable
 {
 public:
     flip_face(shared_ptr<hittable> p) : ptr(p) {}
 
-    virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override
     {
         if (!ptr->hit(r, t_min, t_max, rec))
             return false;
 
+        rec.resolve(r);
         rec.front_face = !rec.front_face;
         return true;
     }
 
-    virtual bool bounding_box(double time0, double time1, aabb& output_box) const override
+    virtual bool bounding_box(real time0, real time1, aabb& output_box) const override
     {
         return ptr->bounding_box(time0, time1, output_box);
     }
 
+    virtual real pdf_value(const point3& o, const vec3& v) const override
+    {
+        return ptr->pdf_value(o, v);
+    }
+
+    virtual vec3 random(const point3& o) const override
+    {
+        return ptr->random(o);
+    }
+
+    virtual real light_power() const override
+    {
+        return ptr->light_power();
+    }
+
+    virtual bool sample_point(surface_sample& s) const override
+    {
+        if (!ptr->sample_point(s))
+            return false;
+        s.normal = -s.normal;
+        return true;
+    }
+
+    // һԴбҪת
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const override
+    {
+        std::vector<shared_ptr<hittable>> inner;
+        ptr->collect_lights(ptr, inner);
+        for (const auto& light : inner)
+            lights.push_back(light == ptr ? self : arena_make<flip_face>(light));
+    }
+
+    virtual void compile(scene_storage& scene) override
+    {
+        ptr->compile(scene);
+    }
+
 public:
     shared_ptr<hittable> ptr;
 };
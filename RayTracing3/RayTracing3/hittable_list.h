@@ -18,16 +18,23 @@ public:
     void clear() { objects.clear(); }
     void add(shared_ptr<hittable> object) { objects.push_back(object); }
 
-    virtual bool hit(const ray& r, double tmin, double tmax, hit_record& rec) const;
-    virtual bool bounding_box(double t0, double t1, aabb& output_box) const;
-    virtual double pdf_value(const point3& o, const vec3& v) const;
+    virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const;
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const;
+    virtual real pdf_value(const point3& o, const vec3& v) const;
     virtual vec3 random(const point3& o) const;
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const;
+    virtual void compile(scene_storage& scene) override
+    {
+        for (const auto& object : objects)
+            object->compile(scene);
+    }
+    virtual unsigned hit_packet(const ray_packet& rp, real t_min, real* t_max, hit_record* recs, unsigned active) const;
 
 public:
     std::vector<shared_ptr<hittable>> objects;
 };
 
-bool hittable_list::hit(const ray& r, double t_min, double t_max, hit_record& rec) const 
+bool hittable_list::hit(const ray& r, real t_min, real t_max, hit_record& rec) const 
 {
     hit_record temp_rec;
     bool hit_anything = false;
@@ -46,7 +53,17 @@ bool hittable_list::hit(const ray& r, double t_min, double t_max, hit_record& re
     return hit_anything;
 }
 
-bool hittable_list::bounding_box(double t0, double t1, aabb& output_box) const 
+unsigned hittable_list::hit_packet(const ray_packet& rp, real t_min, real* t_max, hit_record* recs, unsigned active) const
+{
+    unsigned hits = 0;
+
+    for (const auto& object : objects)
+        hits |= object->hit_packet(rp, t_min, t_max, recs, active);
+
+    return hits;
+}
+
+bool hittable_list::bounding_box(real t0, real t1, aabb& output_box) const 
 {
     if (objects.empty()) return false;
 
@@ -63,8 +80,11 @@ bool hittable_list::bounding_box(double t0, double t1, aabb& output_box) const
     return true;
 }
 
-double hittable_list::pdf_value(const point3& o, const vec3& v) const
+real hittable_list::pdf_value(const point3& o, const vec3& v) const
 {
+    if (objects.empty())
+        return 0;
+
     auto weight = 1.0 / objects.size();
     auto sum = 0.0;
 
@@ -77,8 +97,16 @@ double hittable_list::pdf_value(const point3& o, const vec3& v) const
 vec3 hittable_list::random(const point3& o) const
 {
     auto int_size = static_cast<int>(objects.size());
+    if (int_size == 0)
+        return vec3(1, 0, 0);
 
-    return objects[random_int(0, int_size - 1)]->random(o);
+    return objects[sample_int(sample_dim::bounce_light, 0, int_size - 1)]->random(o);
+}
+
+void hittable_list::collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const
+{
+    for (const auto& object : objects)
+        object->collect_lights(object, lights);
 }
 
 #endif
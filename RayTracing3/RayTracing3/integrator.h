@@ -0,0 +1,246 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include <vector>
+#include "rtweekend.h"
+#include "hittable.h"
+#include "material.h"
+#include "pdf.h"
+#include "sampler.h"
+#include "guiding.h"
+#include "photon_map.h"
+#include "irradiance_cache.h"
+#include "light_list.h"
+
+// ·׷ٻray_color һ߿ʼ׷·Լõȫֿغͳ
+
+// use_cache Ϊ false ʱնȻ棬Լ̽·
+color shade(const ray& r, const hit_record& rec, const color& background,
+            const hittable& world, const light_list& lights, int depth, bool use_cache = true);
+
+// ˹̣ rr_min_depth ֮·ֹҴ·Դʱƫ
+// max_depth ֻΪȫ
+int rr_min_depth = 3;
+// ͳư̷ֱ߳߳ȾĹ߳̽ʱܵ߳
+thread_local long long path_bounces = 0;    // ͳƣ·ĵ֮ͣڼƽ·
+thread_local long long shadow_rays = 0;     // ͳƣֱӹղӰ
+
+// ֱӹղÿǾ潻㳯ԴһӰߣ BSDF ʽҪԲ
+// رʱ˻صԴ BSDF ռһĻPDFֻ׷һ
+bool next_event_estimation = true;
+
+// ·Ϊ nullptr ʱѾѧֲ䶥 guide_fraction ĸʰѧķֲɢ䷽
+// guide->training Ϊ true ʱÿ·ڸõȼ¼ȥ
+path_guide* guide = nullptr;
+real guide_fraction = 0.5;
+
+// ɢͼΪ nullptr ʱ䶥ӹͼȡɢ·ԼҵĽɢֻ֮浽Դټ
+photon_map* caustics = nullptr;
+
+// նȻ棺Ϊ nullptr ʱ·Ѿй䶥֮ lambertian 治ټ׷٣
+// ⣨ֱӹպͼӹգӻֵΪ  /  * ն
+irradiance_cache* diffuse_cache = nullptr;
+
+color cached_irradiance(const hit_record& rec, real time, const color& background,
+                        const hittable& world, const light_list& lights, int depth);
+
+// ɫ
+color ray_color(const ray& r, 
+                const color& background, 
+                const hittable& world,
+                const light_list& lights, 
+                int depth)
+{
+    hit_record rec;
+
+    // ǳ˹߷ļޣͲиĹⱻռ
+    if (depth <= 0)
+        return color(0, 0, 0);
+
+    // ǱbugЩ巴Ĺ߻t=0ʱٴλԼ趨Ϊ0.001
+    if (!world.hit(r, 0.001, infinity, rec))
+        return background;
+
+    // ֻΪĽ㷨ߡuv Ͳ
+    rec.resolve(r);
+
+    return shade(r, rec, background, world, lights, depth);
+}
+
+// ѾõĽ㿪ʼ׷·߽߰Ҳ
+// throughput ֮ǰε˥֮ÿεĹ׳ۼӣٵݹ
+color shade(const ray& r_in,
+            const hit_record& rec_in,
+            const color& background,
+            const hittable& world,
+            const light_list& lights,
+            int depth,
+            bool use_cache)
+{
+    ray r = r_in;
+    hit_record rec = rec_in;
+    color radiance(0, 0, 0);
+    color throughput(1, 1, 1);
+    real bsdf_pdf = 0;      // õ r  BSDF ܶȣ0 ʾ߻淴䣬йԴʱҪ MIS
+
+    // ·ѵ·ÿ䶥õȼ¼ṹ
+    thread_local std::vector<guide_vertex> vertices;
+    vertices.clear();
+    bool training = guide && guide->training;
+
+    bool diffuse_seen = false;  // ·Ѿй䶥
+    bool caustic_path = false;  // һ䶥ֻ֮˾淴/䣬ԴĽɢɹͼ
+
+    for (int bounce = 0; ; bounce++)
+    {
+        sample_bounce(bounce);
+        scatter_record srec;
+        const material& mat = current_scene().mat(rec.mat_id);
+        auto emitted = mat.emitted(r, rec, rec.u, rec.v, rec.p);
+
+        if (caustic_path)
+            emitted = color(0, 0, 0);
+
+        // һĹԴҲȡԷֻ BSDF һ
+        if (bsdf_pdf > 0 && (emitted.x() > 0 || emitted.y() > 0 || emitted.z() > 0))
+            emitted *= power_heuristic(bsdf_pdf, lights.pdf_value(r.origin(), r.direction()));
+
+        // ֱӹѾɹԴֲֻѧӹ⣺һֱӿԷⲻ¼
+        // 淴/ŵģɢճ¼
+        for (auto& v : vertices)
+        {
+            if (v.bounce + 1 != bounce)
+                v.add(throughput * emitted);
+        }
+        radiance += throughput * emitted;
+
+        if (!mat.scatter(r, rec, srec))
+            break;
+
+        if (use_cache && diffuse_cache && diffuse_seen && depth > 1 && !srec.is_specular && mat.is_lambertian())
+        {
+            radiance += throughput * srec.attenuation * cached_irradiance(rec, r.time(), background, world, lights, depth) / pi;
+            break;
+        }
+
+        if (caustics && !srec.is_specular)
+        {
+            auto caustic = throughput * caustics->gather(r, rec, srec, mat);
+            radiance += caustic;
+            for (auto& v : vertices)
+                v.add(caustic);
+        }
+        caustic_path = caustics && srec.is_specular && diffuse_seen;
+        diffuse_seen = diffuse_seen || !srec.is_specular;
+
+        ray scattered;
+        guide_leaf* region = nullptr;   // ·䶥ڵĿռҶ
+        if (srec.is_specular)
+        {
+            // ʽ
+            throughput = throughput * srec.attenuation;
+            scattered = srec.specular_ray;
+            bsdf_pdf = 0;
+        }
+        else if (next_event_estimation)
+        {
+            // ѧֲɢ䷽ֲ BSDF ֮ϲ
+            // Դ MIS ȨҲҪϺܶ
+            region = guide ? &guide->leaf_at(rec.p, rec.normal) : nullptr;
+            const dtree* learned = region && region->sampling.total() > 0 ? &region->sampling : nullptr;
+            guided_pdf guided(learned, srec.surface_pdf, guide_fraction);
+            const pdf& scatter_pdf = learned ? static_cast<const pdf&>(guided) : srec.surface_pdf;
+
+            ray shadow;
+            color weight;
+            sample_bounce(bounce, true);
+            if (sample_light(lights, r, rec, srec, mat, shadow, weight, &scatter_pdf))
+            {
+                shadow_rays++;
+                auto direct = throughput * weight * shadow_emission(world, shadow);
+                radiance += direct;
+                for (auto& v : vertices)
+                    v.add(direct);
+            }
+
+            sample_bounce(bounce);
+            scattered = ray(rec.p, scatter_pdf.generate(), r.time());
+            bsdf_pdf = scatter_pdf.value(scattered.direction());
+            if (!(bsdf_pdf > 0))
+                break;
+            throughput = throughput * srec.attenuation * mat.scattering_pdf(r, rec, scattered) / bsdf_pdf;
+        }
+        else
+        {
+            // PDFջϣÿε䲻жѷü
+            // ûйԴֻб⣩ʱԴһȡЧֻ BSDF 
+            hittable_pdf light_pdf(lights, rec.p);
+            mixture_pdf mixture(light_pdf, srec.surface_pdf);
+            const pdf& p = lights.empty() ? static_cast<const pdf&>(srec.surface_pdf) : mixture;
+
+            scattered = ray(rec.p, p.generate(), r.time());
+            auto pdf_val = p.value(scattered.direction());
+            throughput = throughput * srec.attenuation * mat.scattering_pdf(r, rec, scattered) / pdf_val;
+        }
+
+        if (--depth <= 0)
+            break;
+
+        if (bounce + 1 >= rr_min_depth)
+        {
+            auto survive = ffmin(ffmax(throughput.x(), ffmax(throughput.y(), throughput.z())), real(0.95));
+            if (!(random_double() < survive))
+                break;
+            throughput /= survive;
+        }
+
+        if (training && region)
+            vertices.push_back({ region, scattered.direction(), bsdf_pdf, throughput, color(0, 0, 0), bounce });
+
+        path_bounces++;
+        r = scattered;
+        if (!world.hit(r, 0.001, infinity, rec))
+        {
+            radiance += throughput * background;
+            for (auto& v : vertices)
+                v.add(throughput * background);
+            break;
+        }
+        rec.resolve(r);
+    }
+
+    for (const auto& v : vertices)
+        guide->record(*v.leaf, v.direction, luminance(v.radiance), v.pdf);
+
+    return radiance;
+}
+
+// û㹻ļ¼ʱ½һ̽·׷٣ڼ䲻ٲ黺棬
+// Ҳռ·ĵͲάȡ̽һ֮һε䣬ܳ max_depth 
+color cached_irradiance(const hit_record& rec, real time, const color& background,
+                        const hittable& world, const light_list& lights, int depth)
+{
+    color irradiance;
+    if (diffuse_cache->lookup(rec.p, rec.normal, irradiance))
+        return irradiance;
+
+    // ̽·ö뿪ʱָ·Ĳ
+    sampler_scope independent(nullptr);
+    auto record = diffuse_cache->compute(rec.p, rec.normal, time, [&](const ray& probe, real& distance)
+    {
+        hit_record hit;
+        if (!world.hit(probe, 0.001, infinity, hit))
+        {
+            distance = infinity;
+            return background;
+        }
+        hit.resolve(probe);
+        distance = hit.t * probe.direction().length();
+        return shade(probe, hit, background, world, lights, depth - 1, false);
+    });
+
+    diffuse_cache->add(record);
+    return record.irradiance;
+}
+
+#endif
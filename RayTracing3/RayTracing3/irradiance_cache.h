@@ -0,0 +1,264 @@
+#ifndef IRRADIANCE_CACHE_H
+#define IRRADIANCE_CACHE_H
+
+#include <vector>
+#include "rtweekend.h"
+#include "aabb.h"
+
+// նȻ棨Ward et al. 1988ƽƺתݶȣWard & Heckbert 1992
+// lambertian ĳ  /  * նȣնڱϱ仯ƽϡؼٲֵ
+// ÿ¼ڰϰҷֲֲ㷢 M x N ̽ߣõն EΧĵƽ R
+//  E λá߱仯ݶȡɫ p Ϊ |p - p_i| / R_i + sqrt(1 - nn_i)
+// С accuracy ļ¼Ȩ 1/ - 1/accuracy ֵʱɵ߼һ¼¼
+// ¼Ӱ뾶 accuracy * R_i Ž˲PBRT v2 ڱ߳Ӱ췶Χ൱Ľڵ
+// ѯʱֻӸ p Ҷ·ϵĽڵ㡣
+// ƫƣaccuracy ԽС¼ԽܣR_i  [min_spacing, max_spacing] Խ֮䣬
+// Ҳ E / |ƽݶ|ȱ仯ĵط¼ܣÿ¼̽¼
+struct irradiance_record
+{
+    point3 p;
+    vec3 normal;
+    color irradiance;
+    real radius;                // Ч뾶 R
+    vec3 translation[3];        // ÿɫƽݶ
+    vec3 rotation[3];           // ÿɫתݶȣߴ normal ת n ʱ E 仯 dot(cross(normal, n), rotation)
+};
+
+class irradiance_cache
+{
+public:
+    irradiance_cache(const aabb& bounds)
+    {
+        auto size = bounds.max() - bounds.min();
+        auto extent = ffmax(size.x(), ffmax(size.y(), size.z())) * real(1.01) + real(1e-3);
+        origin = bounds.min() - vec3(1, 1, 1) * (extent * real(0.005));
+        root_size = extent;
+        diagonal = size.length();
+        nodes.push_back(node());
+    }
+
+    // ֵõ p Ϊ nķնȣû㹻ļ¼ʱ false
+    bool lookup(const point3& p, const vec3& n, color& irradiance) const;
+
+    //  p һ¼¼trace(ray, distance) ߽̽ķȣľ루ûнΪ infinity
+    template <typename F>
+    irradiance_record compute(const point3& p, const vec3& n, real time, F trace) const;
+
+    void add(const irradiance_record& record);
+
+    size_t size() const { return records.size(); }
+
+public:
+    real accuracy = real(0.25);
+    real min_spacing = real(0.005);     // Ч뾶ޣڳΧеĶԽ
+    real max_spacing = real(0.2);
+    int theta_strata = 8;               // ̽ߵķֲ㣺theta_strata x phi_strata 
+    int phi_strata = 24;
+    int max_octree_depth = 16;
+
+private:
+    struct node
+    {
+        int child[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };     // 0 ʾûӽڵ㣨ڵ㲻κνڵĺӣ
+        std::vector<int> records;
+    };
+
+    std::vector<irradiance_record> records;
+    std::vector<node> nodes;
+    point3 origin;
+    real root_size;
+    real diagonal;
+};
+
+bool irradiance_cache::lookup(const point3& p, const vec3& n, color& irradiance) const
+{
+    color sum(0, 0, 0);
+    real total_weight = 0;
+
+    // Ӹߵ p ڵҶӣ·ÿڵļ¼
+    auto corner = origin;
+    auto size = root_size;
+    int index = 0;
+    while (true)
+    {
+        for (int i : nodes[index].records)
+        {
+            const irradiance_record& rec = records[i];
+            auto d = p - rec.p;
+
+            // ¼ p ڱǰܱ p ļεס
+            if (dot(d, rec.normal + n) < -real(0.02) * rec.radius)
+                continue;
+
+            auto error = d.length() / rec.radius + sqrt(ffmax(0, 1 - dot(n, rec.normal)));
+            if (error >= accuracy)
+                continue;
+
+            auto weight = 1 / ffmax(error, real(1e-6)) - 1 / accuracy;
+            auto axis = cross(rec.normal, n);
+            for (int c = 0; c < 3; c++)
+                sum[c] += weight * (rec.irradiance[c] + dot(d, rec.translation[c]) + dot(axis, rec.rotation[c]));
+            total_weight += weight;
+        }
+
+        size /= 2;
+        int octant = 0;
+        for (int a = 0; a < 3; a++)
+        {
+            if (p[a] >= corner[a] + size)
+            {
+                octant |= 1 << a;
+                corner[a] += size;
+            }
+        }
+        if (nodes[index].child[octant] == 0)
+            break;
+        index = nodes[index].child[octant];
+    }
+
+    if (!(total_weight > 0))
+        return false;
+
+    // ݶƿܵõֵ
+    for (int c = 0; c < 3; c++)
+        irradiance[c] = ffmax(sum[c] / total_weight, 0);
+    return true;
+}
+
+// ̽߰ sin^2(theta)  phi ֲ㣬ÿһҷֲµķֲE =  / (M N) *  L
+// ݶ Ward & Heckbert Ĺʽڷֲ֮ȵĲǵľ
+template <typename F>
+irradiance_record irradiance_cache::compute(const point3& p, const vec3& n, real time, F trace) const
+{
+    int M = theta_strata, N = phi_strata;
+    std::vector<color> L(M * N);
+    std::vector<real> dist(M * N), sin_theta(M * N);
+
+    onb uvw;
+    uvw.build_from_w(n);
+    irradiance_record record;
+    record.p = p;
+    record.normal = unit_vector(n);
+    record.irradiance = color(0, 0, 0);
+    for (int c = 0; c < 3; c++)
+        record.translation[c] = record.rotation[c] = vec3(0, 0, 0);
+
+    real inverse_distance = 0;
+    for (int j = 0; j < M; j++)
+    {
+        for (int k = 0; k < N; k++)
+        {
+            auto s2 = (j + random_double()) / M;
+            auto phi = 2 * pi * (k + random_double()) / N;
+            auto st = sqrt(s2);
+            auto ct = sqrt(ffmax(0, 1 - s2));
+            auto w = uvw.local(st * cos(phi), st * sin(phi), ct);
+
+            int i = j * N + k;
+            L[i] = trace(ray(p, w, time), dist[i]);
+            sin_theta[i] = st;
+            record.irradiance += L[i];
+            inverse_distance += 1 / dist[i];
+
+            // תݶȣ L (n  ) dأҷֲܶ cos /  
+            auto axis = cross(record.normal, w) / ffmax(ct, real(1e-3));
+            for (int c = 0; c < 3; c++)
+                record.rotation[c] += L[i][c] * axis;
+        }
+    }
+
+    auto scale = pi / (M * N);
+    record.irradiance *= scale;
+    for (int c = 0; c < 3; c++)
+        record.rotation[c] *= scale;
+
+    // ƽݶȣtheta ֮ı߽磨Ϊ u_k phi ֮ı߽磨Ϊ v_k
+    for (int k = 0; k < N; k++)
+    {
+        auto phi = 2 * pi * (k + real(0.5)) / N;
+        auto phi_minus = 2 * pi * k / N;
+        auto u_k = uvw.local(cos(phi), sin(phi), 0);
+        auto v_k = uvw.local(-sin(phi_minus), cos(phi_minus), 0);
+        int prev_k = (k + N - 1) % N;
+
+        for (int j = 0; j < M; j++)
+        {
+            auto sin_minus = sqrt(real(j) / M);
+            auto cos_minus = sqrt(1 - real(j) / M);
+            auto cos_plus = sqrt(ffmax(0, 1 - real(j + 1) / M));
+            int i = j * N + k;
+
+            if (j > 0)
+            {
+                int below = (j - 1) * N + k;
+                auto weight = (2 * pi / N) * sin_minus * cos_minus * cos_minus / ffmin(dist[i], dist[below]);
+                for (int c = 0; c < 3; c++)
+                    record.translation[c] += u_k * (weight * (L[i][c] - L[below][c]));
+            }
+
+            int left = j * N + prev_k;
+            auto weight = (cos_minus - cos_plus) / (ffmax(sin_theta[i], real(1e-3)) * ffmin(dist[i], dist[left]));
+            for (int c = 0; c < 3; c++)
+                record.translation[c] += v_k * (weight * (L[i][c] - L[left][c]));
+        }
+    }
+
+    // Ч뾶ƽ룬֮䣬ϰƽݶƵı仯 E 
+    auto radius = inverse_distance > 0 ? (M * N) / inverse_distance : infinity;
+    for (int c = 0; c < 3; c++)
+    {
+        auto grad = record.translation[c].length();
+        if (grad > 0 && record.irradiance[c] > 0)
+            radius = ffmin(radius, record.irradiance[c] / grad);
+    }
+    record.radius = clamp(radius, min_spacing * diagonal, max_spacing * diagonal);
+    return record;
+}
+
+// Ӱ췶Χǰ뾶 accuracy * R 򣬷Ž߳Сֱڵ㣬Խӽڵʱÿһ
+void irradiance_cache::add(const irradiance_record& record)
+{
+    int id = static_cast<int>(records.size());
+    records.push_back(record);
+    auto reach = accuracy * record.radius;
+
+    struct item { int index; point3 corner; real size; int depth; };
+    std::vector<item> stack = { { 0, origin, root_size, 0 } };
+    while (!stack.empty())
+    {
+        auto it = stack.back();
+        stack.pop_back();
+
+        auto half = it.size / 2;
+        if (it.depth >= max_octree_depth || half < 2 * reach)
+        {
+            nodes[it.index].records.push_back(id);
+            continue;
+        }
+
+        for (int octant = 0; octant < 8; octant++)
+        {
+            point3 corner = it.corner;
+            bool overlaps = true;
+            for (int a = 0; a < 3; a++)
+            {
+                if (octant >> a & 1)
+                    corner[a] += half;
+                if (record.p[a] + reach < corner[a] || record.p[a] - reach > corner[a] + half)
+                    overlaps = false;
+            }
+            if (!overlaps)
+                continue;
+
+            if (nodes[it.index].child[octant] == 0)
+            {
+                int child = static_cast<int>(nodes.size());
+                nodes.push_back(node());
+                nodes[it.index].child[octant] = child;
+            }
+            stack.push_back({ nodes[it.index].child[octant], corner, half, it.depth + 1 });
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef LIGHT_LIST_H
+#define LIGHT_LIST_H
+
+#include <algorithm>
+#include <vector>
+#include "rtweekend.h"
+#include "hittable.h"
+
+// ԴṹѡԴ
+// ԴʱñWalker/VoseO(1) ѡһԴѡеĸĹʣ
+// ԴܶʱһùԴ BVHӸ°ɫ㴦Ĺƹף / ƽ
+// ѡһߣpdf_value ֻʱ򴩹 O(log n) Դ
+class light_list : public hittable
+{
+public:
+    light_list() {}
+    light_list(const std::vector<shared_ptr<hittable>>& found, size_t bvh_threshold = 64);
+
+    bool empty() const { return lights.empty(); }
+    size_t size() const { return lights.size(); }
+
+    // ñѡһԴɫ޹أѡе i ĸ select_pdf[i]
+    int pick(real u) const
+    {
+        auto n = static_cast<int>(lights.size());
+        auto scaled = u * n;
+        int i = std::min(static_cast<int>(scaled), n - 1);
+        return (scaled - i) < alias_prob[i] ? i : alias[i];
+    }
+
+    // Դֻ
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override
+    {
+        return false;
+    }
+
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const override
+    {
+        return false;
+    }
+
+    virtual real pdf_value(const point3& o, const vec3& v) const override;
+    virtual vec3 random(const point3& o) const override;
+
+public:
+    std::vector<shared_ptr<hittable>> lights;
+    std::vector<real> select_pdf;       // ÿԴѡеĸ
+    real total_power = 0;               // йԴĹ֮ͣѡڱϾȡ㣬
+                                        // ԴһܶȾ  * Է / total_power
+
+private:
+    // Դ BVH Ľڵ㣬ҶֻһԴ
+    struct node
+    {
+        aabb box;
+        point3 center;
+        real radius_squared;            // ΧаԽ߳ȵƽúܽʱƹֵ
+        real power;
+        int left;                       // ҶΪ -1
+        int right;
+        int light;                      // ҶӶӦĹԴ±
+    };
+
+    void build_alias_table();
+    int build_node(std::vector<int>& ids, size_t start, size_t end, const std::vector<aabb>& boxes);
+
+    // ɫĹƹ
+    real importance(const node& n, const point3& o) const
+    {
+        auto d = (n.center - o).length_squared();
+        return n.power / ffmax(d, n.radius_squared);
+    }
+
+    real bvh_pdf(int index, const point3& o, const vec3& v, real prob) const;
+
+private:
+    std::vector<real> alias_prob;       //  i Լĸʣ alias[i]
+    std::vector<int> alias;
+    std::vector<node> nodes;            // ΪձʾùԴ BVH
+};
+
+light_list::light_list(const std::vector<shared_ptr<hittable>>& found, size_t bvh_threshold)
+{
+    // ûйʵĹԴѡֻ BSDF УǷϵĹԴPDFΪ 0MIS Ȩ 1
+    for (const auto& light : found)
+    {
+        if (light->light_power() > 0)
+            lights.push_back(light);
+    }
+
+    build_alias_table();
+
+    std::vector<aabb> boxes(lights.size());
+    bool bounded = true;
+    for (size_t i = 0; i < lights.size(); i++)
+        bounded = bounded && lights[i]->bounding_box(0, 1, boxes[i]);
+
+    if (lights.size() > bvh_threshold && bounded)
+    {
+        std::vector<int> ids(lights.size());
+        for (size_t i = 0; i < ids.size(); i++)
+            ids[i] = static_cast<int>(i);
+        nodes.reserve(2 * lights.size());
+        build_node(ids, 0, ids.size(), boxes);
+    }
+}
+
+// Vose Ĺ췽ʲƽֵĸһƽֵĹԴ
+void light_list::build_alias_table()
+{
+    auto n = lights.size();
+    select_pdf.resize(n);
+    alias_prob.resize(n);
+    alias.resize(n);
+    if (n == 0)
+        return;
+
+    real total = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        select_pdf[i] = lights[i]->light_power();
+        total += select_pdf[i];
+    }
+    total_power = total;
+
+    std::vector<int> small, large;
+    std::vector<real> scaled(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        select_pdf[i] /= total;
+        scaled[i] = select_pdf[i] * n;
+        (scaled[i] < 1 ? small : large).push_back(static_cast<int>(i));
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        int s = small.back();
+        int l = large.back();
+        small.pop_back();
+        large.pop_back();
+
+        alias_prob[s] = scaled[s];
+        alias[s] = l;
+        scaled[l] -= 1 - scaled[s];
+        (scaled[l] < 1 ? small : large).push_back(l);
+    }
+
+    // ʣµĸֻԼ
+    for (int i : small)
+    {
+        alias_prob[i] = 1;
+        alias[i] = i;
+    }
+    for (int i : large)
+    {
+        alias_prob[i] = 1;
+        alias[i] = i;
+    }
+}
+
+// Χϵλֳ
+int light_list::build_node(std::vector<int>& ids, size_t start, size_t end, const std::vector<aabb>& boxes)
+{
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back(node());
+
+    node n;
+    n.box = boxes[ids[start]];
+    n.power = 0;
+    for (size_t i = start; i < end; i++)
+    {
+        n.box = surrounding_box(n.box, boxes[ids[i]]);
+        n.power += lights[ids[i]]->light_power();
+    }
+    n.center = 0.5 * (n.box.min() + n.box.max());
+    n.radius_squared = 0.25 * (n.box.max() - n.box.min()).length_squared();
+    n.left = n.right = n.light = -1;
+
+    if (end - start == 1)
+    {
+        n.light = ids[start];
+    }
+    else
+    {
+        int axis = 0;
+        auto extent = n.box.max() - n.box.min();
+        if (extent.y() > extent[axis])
+            axis = 1;
+        if (extent.z() > extent[axis])
+            axis = 2;
+
+        auto mid = start + (end - start) / 2;
+        std::nth_element(ids.begin() + start, ids.begin() + mid, ids.begin() + end, [&](int a, int b)
+        {
+            return boxes[a].min()[axis] + boxes[a].max()[axis] < boxes[b].min()[axis] + boxes[b].max()[axis];
+        });
+
+        n.left = build_node(ids, start, mid, boxes);
+        n.right = build_node(ids, mid, end, boxes);
+    }
+
+    nodes[index] = n;
+    return index;
+}
+
+// ĸܶȣйԴѡеĸʳԼ֮ܶ
+real light_list::pdf_value(const point3& o, const vec3& v) const
+{
+    if (lights.empty())
+        return 0;
+
+    if (!nodes.empty())
+        return bvh_pdf(0, o, v, 1);
+
+    real sum = 0;
+    for (size_t i = 0; i < lights.size(); i++)
+        sum += select_pdf[i] * lights[i]->pdf_value(o, v);
+    return sum;
+}
+
+// ֻз򴩹ſзܶȣprob ǴӸߵڵĸ
+real light_list::bvh_pdf(int index, const point3& o, const vec3& v, real prob) const
+{
+    const node& n = nodes[index];
+    if (!n.box.hit(ray(o, v), 0.001, infinity))
+        return 0;
+
+    if (n.light >= 0)
+        return prob * lights[n.light]->pdf_value(o, v);
+
+    auto il = importance(nodes[n.left], o);
+    auto ir = importance(nodes[n.right], o);
+    auto pl = il / (il + ir);
+
+    return bvh_pdf(n.left, o, v, prob * pl) + bvh_pdf(n.right, o, v, prob * (1 - pl));
+}
+
+vec3 light_list::random(const point3& o) const
+{
+    if (lights.empty())
+        return vec3(1, 0, 0);
+
+    auto u = sample_1d(sample_dim::bounce_light);
+    int light;
+
+    if (!nodes.empty())
+    {
+        // ÿһͬһѡһߺӳ [0,1)
+        int index = 0;
+        while (nodes[index].light < 0)
+        {
+            const node& n = nodes[index];
+            auto il = importance(nodes[n.left], o);
+            auto ir = importance(nodes[n.right], o);
+            auto pl = il / (il + ir);
+
+            if (u < pl)
+            {
+                u = u / pl;
+                index = n.left;
+            }
+            else
+            {
+                u = ffmin((u - pl) / (1 - pl), real(0.99999994));
+                index = n.right;
+            }
+        }
+        light = nodes[index].light;
+    }
+    else
+    {
+        light = pick(u);
+    }
+
+    return lights[light]->random(o);
+}
+
+#endif
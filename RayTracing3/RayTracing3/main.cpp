@@ -2,302 +2,110 @@
 #include <fstream>
 #include <cmath>
 #include <cstdlib>
+#include <chrono>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-#include "hittable_list.h"
-#include "sphere.h"
-#include "moving_sphere.h"
 #include "camera.h"
-#include "material.h"
-#include "bvh.h"
-#include "aarect.h"
-#include "box.h"
-#include "constant_medium.h"
-
-// ɫ
-color ray_color(const ray& r, 
-                const color& background, 
-                const hittable& world,
-                shared_ptr<hittable> lights, 
-                int depth)
+#include "scenes.h"
+#include "integrator.h"
+#include "typed_list.h"
+#include "wavefront.h"
+#include "bdpt.h"
+#include "mlt.h"
+#include "irradiance_cache.h"
+#include "light_list.h"
+#include "guiding.h"
+#include "photon_map.h"
+
+// ܲԣturb  noise_packet ÿĲѯ
+void noise_benchmark()
 {
-    hit_record rec;
-
-    // ǳ˹߷ļޣͲиĹⱻռ
-    if (depth <= 0)
-        return color(0, 0, 0);
-
-    // ǱbugЩ巴Ĺ߻t=0ʱٴλԼ趨Ϊ0.001
-    if (!world.hit(r, 0.001, infinity, rec))
-        return background;
-
-    scatter_record srec;
-    color emitted = rec.mat_ptr->emitted(r, rec, rec.u, rec.v, rec.p);
-
-    if (!rec.mat_ptr->scatter(r, rec, srec))
-        return emitted;
-
-    // ʽ
-    if (srec.is_specular)
-    {
-        return srec.attenuation * ray_color(srec.specular_ray, background, world, lights, depth - 1);
-    }
-
-    auto light_ptr = make_shared<hittable_pdf>(lights, rec.p);
-    mixture_pdf p(light_ptr, srec.pdf_ptr);
-
-    ray scattered = ray(rec.p, p.generate(), r.time());
-    auto pdf_val = p.value(scattered.direction());
-
-    return emitted + srec.attenuation * rec.mat_ptr->scattering_pdf(r, rec, scattered) 
-                                      * ray_color(scattered, background, world, lights, depth - 1) / pdf_val;
-}
-
-// 
-hittable_list random_scene() 
-{
-    hittable_list world;
-
-    auto checker = make_shared<checker_texture>(
-        make_shared<constant_texture>(vec3(0.2, 0.3, 0.1)),
-        make_shared<constant_texture>(vec3(0.9, 0.9, 0.9)));
-    world.add(make_shared<sphere>(vec3(0, -1000, 0), 1000, make_shared<lambertian>(checker)));
-
-    int i = 1;
-    for (int a = -5; a < 5; a++) 
+    const int n = 1 << 20;
+    perlin noise;
+    std::vector<vec3> points(n);
+    for (auto& p : points)
+        p = vec3::random(-50, 50);
+
+    real sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& p : points)
+        sink += noise.turb(p);
+    std::chrono::duration<double> turb_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i += perlin::lanes)
     {
-        for (int b = -5; b < 5; b++) 
+        real x[perlin::lanes], y[perlin::lanes], z[perlin::lanes], out[perlin::lanes];
+        for (int l = 0; l < perlin::lanes; l++)
         {
-            auto choose_mat = random_double();
-            vec3 center(a + 0.9 * random_double(), 0.2, b + 0.9 * random_double());
-            if ((center - vec3(4, 0.2, 0)).length() > 0.9) 
-            {
-                if (choose_mat < 0.8) 
-                {
-                    // diffuse
-                    auto albedo = vec3::random() * vec3::random();
-                    world.add(make_shared<moving_sphere>(
-                        center, center + vec3(0, random_double(0, .5), 0), 0.0, 1.0, 0.2,
-                        make_shared<lambertian>(albedo)));
-                }
-                else if (choose_mat < 0.95) 
-                {
-                    // metal
-                    auto albedo = vec3::random(0.5, 1);
-                    auto fuzz = random_double(0, 0.5);
-                    world.add(make_shared<sphere>(center, 0.2, make_shared<metal>(albedo, fuzz)));
-                }
-                else 
-                {
-                    // glass
-                    world.add(make_shared<sphere>(center, 0.2, make_shared<dielectric>(1.5)));
-                }
-            }
+            x[l] = points[i + l].x();
+            y[l] = points[i + l].y();
+            z[l] = points[i + l].z();
         }
+        noise.noise_packet(x, y, z, out);
+        for (int l = 0; l < perlin::lanes; l++)
+            sink += out[l];
     }
-    world.add(make_shared<sphere>(vec3(0, 1, 0), 1.0, make_shared<dielectric>(1.5)));
-
-    world.add(make_shared<sphere>(vec3(-4, 1, 0), 1.0, make_shared<lambertian>(vec3(0.4, 0.2, 0.1))));
-
-    world.add(make_shared<sphere>(vec3(4, 1, 0), 1.0, make_shared<metal>(vec3(0.7, 0.6, 0.5), 0.0)));
-
-    return static_cast<hittable_list>(make_shared<bvh_node>(world, 0, 1));;
-}
-
-// 
-hittable_list two_spheres()
-{
-    hittable_list objects;
+    std::chrono::duration<double> noise_time = std::chrono::steady_clock::now() - start;
 
-    auto checker = make_shared<checker_texture>(
-        make_shared<constant_texture>(vec3(0.2, 0.3, 0.1)),
-        make_shared<constant_texture>(vec3(0.9, 0.9, 0.9)));
-
-    objects.add(make_shared<sphere>(vec3(0, -10, 0), 10, make_shared<lambertian>(checker)));
-    objects.add(make_shared<sphere>(vec3(0, 10, 0), 10, make_shared<lambertian>(checker)));
-
-    return objects;
+    std::cout << "Noise: " << (n / turb_time.count()) << " turb lookups/s, "
+              << (n / noise_time.count()) << " noise lookups/s (" << sink << ")\n";
 }
 
-// 
-hittable_list two_perlin_spheres()
+// Դ pdf ܲԣܶȵľֻԲ׶/ƽжϵĽʽÿļ
+// һ뷽ŹԴһ򣬴಻
+void pdf_benchmark()
 {
-    hittable_list objects;
-
-    auto pertext = make_shared<noise_texture>(4);
-    objects.add(make_shared<sphere>(vec3(0, -1000, 0), 1000, make_shared<lambertian>(pertext)));
-    objects.add(make_shared<sphere>(vec3(0, 2, 0), 2, make_shared<lambertian>(pertext)));
-
-    return objects;
-}
-
-// 
-hittable_list earth() {
-    int nx, ny, nn;
-    unsigned char* texture_data = stbi_load("image/earthmap.jpg", &nx, &ny, &nn, 0);
-
-    auto earth_surface = make_shared<lambertian>(make_shared<image_texture>(texture_data, nx, ny));
-    auto globe = make_shared<sphere>(vec3(0, 0, 0), 2, earth_surface);
-
-    return hittable_list(globe);
-}
-
-// 򵥵ľιԴ
-hittable_list simple_light() 
-{
-    hittable_list objects;
-
-    auto pertext = make_shared<noise_texture>(4);
-    objects.add(make_shared<sphere>(vec3(0, -1000, 0), 1000, make_shared<lambertian>(pertext)));
-    objects.add(make_shared<sphere>(vec3(0, 2, 0), 2, make_shared<lambertian>(pertext)));
-
-    auto difflight = make_shared<diffuse_light>(make_shared<constant_texture>(vec3(4, 4, 4)));
-    objects.add(make_shared<sphere>(vec3(0, 7, 0), 2, difflight));      // Դ
-    objects.add(make_shared<xy_rect>(3, 5, 1, 3, -2, difflight));       // ιԴ
-
-    return objects;
-}
-
-// ζӣǽ+
-hittable_list cornell_box() 
-{
-    hittable_list objects;
-
-    auto red = make_shared<lambertian>(vec3(0.65, 0.05, 0.05));
-    auto white = make_shared<lambertian>(vec3(0.73, 0.73, 0.73));
-    auto green = make_shared<lambertian>(vec3(0.12, 0.45, 0.15));
-    auto light = make_shared<diffuse_light>(vec3(15, 15, 15));
-
-    // ζ
-    objects.add(make_shared<yz_rect>(0, 555, 0, 555, 555, green));
-    objects.add(make_shared<yz_rect>(0, 555, 0, 555, 0, red));
-    objects.add(make_shared<flip_face>(make_shared<xz_rect>(213, 343, 227, 332, 554, light)));  // ת
-    objects.add(make_shared<xz_rect>(0, 555, 0, 555, 0, white));
-    objects.add(make_shared<xz_rect>(0, 555, 0, 555, 555, white));
-    objects.add(make_shared<xy_rect>(0, 555, 0, 555, 555, white));
-
-    // һ壬һ
-    //shared_ptr<material> aluminum = make_shared<metal>(color(0.8, 0.85, 0.88), 0.0);
-    //shared_ptr<hittable> box1 = make_shared<box>(vec3(0, 0, 0), vec3(165, 330, 165), aluminum);
-    shared_ptr<hittable> box1 = make_shared<box>(vec3(0, 0, 0), vec3(165, 330, 165), white);
-    box1 = make_shared<rotate_y>(box1, 15);
-    box1 = make_shared<translate>(box1, vec3(265, 0, 295));
-    objects.add(box1);
-
-    auto glass = make_shared<dielectric>(1.5);
-    objects.add(make_shared<sphere>(point3(190, 90, 190), 90, glass));
-
-    return objects;
-}
-
-// ζӣǽ+(ɫǳɫ)
-hittable_list cornell_smoke()
-{
-    hittable_list objects;
-
-    auto red = make_shared<lambertian>(vec3(0.65, 0.05, 0.05));
-    auto white = make_shared<lambertian>(vec3(0.73, 0.73, 0.73));
-    auto green = make_shared<lambertian>(vec3(0.12, 0.45, 0.15));
-    auto light = make_shared<diffuse_light>(vec3(15, 15, 15));
-
-    // ζ
-    objects.add(make_shared<yz_rect>(0, 555, 0, 555, 555, green));
-    objects.add(make_shared<yz_rect>(0, 555, 0, 555, 0, red));
-    objects.add(make_shared<xz_rect>(213, 343, 227, 332, 554, light));
-    objects.add(make_shared<xz_rect>(0, 555, 0, 555, 0, white));
-    objects.add(make_shared<xz_rect>(0, 555, 0, 555, 555, white));
-    objects.add(make_shared<xy_rect>(0, 555, 0, 555, 555, white));
-
-    shared_ptr<hittable> box1 = make_shared<box>(vec3(0, 0, 0), vec3(165, 330, 165), white);
-    box1 = make_shared<rotate_y>(box1, 15);
-    box1 = make_shared<translate>(box1, vec3(265, 0, 295));
-    shared_ptr<hittable> box2 = make_shared<box>(vec3(0, 0, 0), vec3(165, 165, 165), white);
-    box2 = make_shared<rotate_y>(box2, -18);
-    box2 = make_shared<translate>(box2, vec3(130, 0, 65));
-
-    objects.add(make_shared<constant_medium>(box1, 0.01, vec3(0, 0, 0)));
-    objects.add(make_shared<constant_medium>(box2, 0.01, vec3(1, 1, 1)));
-
-    return objects;
-}
-
-// ͨƶ򡢵򡢲򡢽򡢾ιԴʯ
-hittable_list final_scene()
-{
-    // ܶܶΪ
-    hittable_list boxes1;
-    auto ground = make_shared<lambertian>(vec3(0.48, 0.83, 0.53));
-
-    // ܼ400
-    const int boxes_per_side = 20;
-    for (int i = 0; i < boxes_per_side; i++)
+    const int n = 1 << 20;
+    sphere ball(point3(190, 90, 190), 90, make_shared<material>());
+    xz_rect rect(213, 343, 227, 332, 554, make_shared<material>());
+    std::vector<point3> origins(n);
+    std::vector<vec3> to_ball(n), to_rect(n);
+    for (int i = 0; i < n; i++)
     {
-        for (int j = 0; j < boxes_per_side; j++)
-        {
-            auto w = 100.0;
-            auto x0 = -1000.0 + i * w;
-            auto y0 = 0.0;
-            auto z0 = -1000.0 + j * w;
-            auto x1 = x0 + w;
-            auto y1 = random_double(1, 101);
-            auto z1 = z0 + w;
-
-            boxes1.add(make_shared<box>(vec3(x0, y0, z0), vec3(x1, y1, z1), ground));
-        }
+        do
+            origins[i] = vec3::random(0, 550);
+        while ((origins[i] - ball.center).length() <= ball.radius);
+        to_ball[i] = i % 2 ? ball.random(origins[i]) : random_unit_vector();
+        to_rect[i] = i % 2 ? rect.random(origins[i]) : random_unit_vector();
     }
 
-    // 
-    hittable_list objects;
-    
-    // 
-    objects.add(make_shared<bvh_node>(boxes1, 0, 1));
-    // ιԴ
-    auto light = make_shared<diffuse_light>(vec3(15, 15, 15));
-    objects.add(make_shared<xz_rect>(123, 423, 147, 412, 554, light));
-
-    // ˶˶ģ
-    auto center1 = vec3(400, 400, 200);
-    auto center2 = center1 + vec3(30, 0, 0);
-    auto moving_sphere_material = make_shared<lambertian>(vec3(0.7, 0.3, 0.1));
-    objects.add(make_shared<moving_sphere>(center1, center2, 0, 1, 50, moving_sphere_material));
-
-    // ͽ
-    objects.add(make_shared<sphere>(vec3(260, 150, 45), 50, make_shared<dielectric>(1.5)));
-    objects.add(make_shared<sphere>(vec3(0, 150, 145), 50, make_shared<metal>(vec3(0.8, 0.8, 0.9), 1.0)));
-
-    // ɫα淴ڵdielectricڲ壩
-    auto boundary = make_shared<sphere>(vec3(360, 150, 145), 50, make_shared<dielectric>(1.5));
-    objects.add(boundary);
-    objects.add(make_shared<constant_medium>(boundary, 0.2, vec3(0.2, 0.4, 0.9)));
-    boundary = make_shared<sphere>(vec3(0, 0, 0), 5000, make_shared<dielectric>(1.5));
-    objects.add(make_shared<constant_medium>(boundary, 0.0001, vec3(1, 1, 1)));
-
-    // 
-    int nx, ny, nn;
-    auto tex_data = stbi_load("image/earthmap.jpg", &nx, &ny, &nn, 0);
-    auto emat = make_shared<lambertian>(make_shared<image_texture>(tex_data, nx, ny));
-    objects.add(make_shared<sphere>(vec3(400, 200, 400), 100, emat));
-
-    // ʯ򣨰
-    auto pertext = make_shared<noise_texture>(0.1);
-    objects.add(make_shared<sphere>(vec3(220, 280, 300), 80, make_shared<lambertian>(pertext)));
-
-    // 1000ɵ
-    hittable_list boxes2;
-    auto white = make_shared<lambertian>(vec3(0.73, 0.73, 0.73));
-    int ns = 1000;
-    for (int j = 0; j < ns; j++)
+    real sink = 0;
+    auto time = [&](auto&& f)
     {
-        boxes2.add(make_shared<sphere>(vec3::random(0, 165), 10, white));
-    }
-    objects.add(make_shared<translate>
-               (make_shared<rotate_y>
-               (make_shared<bvh_node>(boxes2, 0.0, 1.0), 15), vec3(-100, 270, 395)));
-
-    return objects;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++)
+            sink += f(origins[i], i);
+        std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+        return n / t.count();
+    };
+
+    auto ball_hit = time([&](const point3& o, int i)
+    {
+        hit_record rec;
+        if (!ball.hit(ray(o, to_ball[i]), 0.001, infinity, rec))
+            return real(0);
+        auto cos_theta_max = sqrt(1 - ball.radius * ball.radius / (ball.center - o).length_squared());
+        return 1 / (2 * pi * (1 - cos_theta_max));
+    });
+    auto ball_analytic = time([&](const point3& o, int i) { return ball.pdf_value(o, to_ball[i]); });
+
+    auto rect_hit = time([&](const point3& o, int i)
+    {
+        hit_record rec;
+        ray r(o, to_rect[i]);
+        if (!rect.hit(r, 0.001, infinity, rec))
+            return real(0);
+        spherical_rect sr(o, point3(rect.x0, rect.k, rect.z0), vec3(rect.x1 - rect.x0, 0, 0), vec3(0, 0, rect.z1 - rect.z0));
+        return 1 / sr.solid_angle;
+    });
+    auto rect_analytic = time([&](const point3& o, int i) { return rect.pdf_value(o, to_rect[i]); });
+
+    std::cout << "Light pdf: sphere " << ball_hit << " -> " << ball_analytic << " evals/s, rect "
+              << rect_hit << " -> " << rect_analytic << " evals/s (" << sink << ")\n";
 }
 
 int main() 
@@ -306,8 +114,35 @@ int main()
     int image_width = 600;
     int image_height = 600;
     int samples_per_pixel = 100;    // ز
-    int max_depth = 50;             // depth  ray_color ݹ
-    auto aspect_ratio = double(image_width) / image_height;   // ݺ
+    int max_depth = 50;             // ·൯Ĵж˹ֻ֮Ϊȫ
+    bool use_packets = true;        // ߰߰packet_size أһBVHֻڶһ BVH ʱЧ
+    bool use_typed_lists = true;    // 尴ͷţ󽻲麯
+    bool use_wavefront = false;     // òǰ·صݹ ray_color
+    bool reorder_rays = false;      // ǰǰ
+    bool run_noise_benchmark = false;   // ȾǰȲһ°ÿĲѯ
+    bool run_pdf_benchmark = false;     // ȾǰȲһ¹Դ pdf ÿļ
+    bool use_sobol = true;          // вά Owen ҵ Sobol Уöľ
+    bool use_blue_noise = false;    // ͲԤֲĻϣҪ use_sobol
+    int light_bvh_threshold = 64;   // ԴʱùԴ BVH ѡԴðʵı
+    bool use_path_guiding = false;  // һֲѵֲٰѧķֲɢ䷽򣨲ڲǰ
+    real guide_training_fraction = 0.5;     // ѵռܲıѵҲͼ
+    bool use_photon_mapping = false;    // ɢɽʽͼ㣨ڲǰ
+    int photons_per_pass = 100000;      // ÿһַĹͬʱͼڴ
+    int photon_spp_per_pass = 4;        // ÿһֹȾĲ
+    real photon_radius = 0;             // ʼѯ뾶0 ʾȡΧжԽߵ 0.5%
+    bool use_bdpt = false;          // ˫·׷ٴ ray_colorֻ֧ڲǰ
+    bool use_metropolis = false;    // ռ Metropolis ⴫䣬ϵÿһһ ray_color ·ڲǰ BDPT
+    int mlt_chains = 1000;          // ɷȾͬƽָ
+    int mlt_bootstrap = 100000;     // ƹһѡĶ·
+    real mlt_large_step = 0.3;      // 󲽱죨ɣĸ
+    real mlt_sigma = 0.01;          // Сı׼
+    uint32_t mlt_seed = 1;          // ͬһ½λһ£߳޹
+    bool use_irradiance_cache = false;  // һ֮ lambertian ӷնȻֵֻڵ̵߳ɨȾ
+    real cache_accuracy = 0.25;         // ֵƣԽС¼ԽܡƫԽС
+    real cache_min_spacing = 0.005;     // ¼Ч뾶ޣڳΧеĶԽ
+    real cache_max_spacing = 0.2;
+    int cache_probe_strata = 8;         // ÿ¼ cache_probe_strata x 3 * cache_probe_strata ̽
+    auto aspect_ratio = real(image_width) / image_height;   // ݺ
     vec3 background(0, 0, 0);       // ɫĬϺɫ
     hittable_list world;            // 
     // 
@@ -320,6 +155,11 @@ int main()
     auto time0 = 0.0;
     auto time1 = 1.0;
 
+    if (run_noise_benchmark)
+        noise_benchmark();
+    if (run_pdf_benchmark)
+        pdf_benchmark();
+
     // ѡ񳡾Լ
     switch (6)
     {
@@ -392,14 +232,40 @@ int main()
         lookat = vec3(278, 278, 0);
         vfov = 40.0;
         break;
+    case 9:
+        world = many_lights();
+        image_width = 600;
+        image_height = 600;
+        aspect_ratio = 1.0;
+        background = vec3(0, 0, 0);
+        samples_per_pixel = 1000;
+        lookfrom = vec3(278, 278, -800);
+        lookat = vec3(278, 278, 0);
+        vfov = 40.0;
+        break;
     default:
         break;
     }
     
-    // ɢĹɫ
-    auto lights = make_shared<hittable_list>();
-    lights->add(make_shared<xz_rect>(213, 343, 227, 332, 554, make_shared<material>()));
-    lights->add(make_shared<sphere>(point3(190, 90, 190), 90, make_shared<material>()));
+    // 볡ʵǼǵʱͼԪ±ꡣֵ֮ͼԪ typed_list ǱͼԪ
+    world.compile(current_scene());
+
+    // ֻ߰ڱ BVH ʱڵԣƽ̵бʱ cornell box󽻸
+    if (!(world.objects.size() == 1 && dynamic_cast<const bvh_node*>(world.objects[0].get())))
+        use_packets = false;
+
+    if (use_typed_lists)
+        world = hittable_list(arena_make<typed_list>(world.objects));
+
+    // ӳռͼԪ BVH ͱ任ΪҪԲĹԴ
+    std::vector<shared_ptr<hittable>> found_lights;
+    world.collect_lights(nullptr, found_lights);
+    auto lights = arena_make<light_list>(found_lights, light_bvh_threshold);
+    std::cout << "Lights: " << lights->size()
+              << (lights->size() > size_t(light_bvh_threshold) ? " (light BVH)" : " (alias table)") << "\n";
+
+    std::cout << "Scene arena: " << current_scene().arena.bytes_used() << " bytes used, "
+              << current_scene().arena.bytes_reserved() << " bytes reserved\n";
 
     std::string render_target = "image/image.ppm";
     std::ofstream ppm_file(render_target, std::ios::binary);
@@ -407,22 +273,250 @@ int main()
 
     camera cam(lookfrom, lookat, vup, vfov, aspect_ratio, aperture, dist_to_focus, time0, time1);
 
-    for (int j = image_height - 1; j >= 0; --j) 
+    if (use_bdpt && (use_wavefront || aperture > 0))
+    {
+        std::cout << "BDPT: needs a pinhole camera and the scanline renderer, falling back to path tracing\n";
+        use_bdpt = false;
+    }
+    if (use_metropolis && (use_wavefront || use_bdpt))
+    {
+        std::cout << "Metropolis: wraps the scanline path tracer, ignored with the wavefront integrator or BDPT\n";
+        use_metropolis = false;
+    }
+
+    sobol_sampler sampler;
+    sampler.image_width = image_width;
+    sampler.samples_per_pixel = samples_per_pixel;
+    sampler.blue_noise = use_blue_noise;
+    if (use_sobol)
+        active_sampler() = &sampler;
+
+    // ʱڱȽ float/double ־ȹ
+    auto start_time = std::chrono::steady_clock::now();
+
+    // Ⱦ·ѵʽӳ䣩ÿһÿ count Ⱦͼ
+    // ۼӽ pass_imageǰ first_sample ֮ʣµѭ
+    std::vector<color> pass_image;
+    int first_sample = 0;
+    auto render_pass = [&](int count)
+    {
+        if (pass_image.empty())
+            pass_image.assign(size_t(image_width) * image_height, color(0, 0, 0));
+        for (int j = 0; j < image_height; ++j)
+            for (int i = 0; i < image_width; ++i)
+                for (int s = first_sample; s < first_sample + count; ++s)
+                {
+                    sampler.start_sample(j * image_width + i, s);
+                    auto u = (i + sample_1d(sample_dim::pixel_x)) / (image_width - 1);
+                    auto v = (j + sample_1d(sample_dim::pixel_y)) / (image_height - 1);
+                    pass_image[size_t(j) * image_width + i] += ray_color(cam.get_ray(u, v), background, world, *lights, max_depth);
+                }
+        first_sample += count;
+    };
+
+    // ·ѵÿһֵĲ 124 һѧķֲȾ¼ȡ
+    // ÿһֶƫĹƣѵҲͼ֮ѧķֲȾ
+    std::unique_ptr<path_guide> learned_guide;
+    aabb scene_bounds;
+    bool bounded = world.bounding_box(time0, time1, scene_bounds);
+    if (use_path_guiding && !use_wavefront && !use_bdpt && !use_metropolis && bounded)
+    {
+        learned_guide.reset(new path_guide(scene_bounds));
+        guide = learned_guide.get();
+
+        int budget = int(samples_per_pixel * guide_training_fraction);
+        int iteration = 0;
+        for (int pass = 1; first_sample + pass <= budget; pass *= 2, iteration++)
+        {
+            std::cout << "\rPath guiding: training pass " << iteration << " (" << pass << " spp) " << std::flush;
+            render_pass(pass);
+            guide->refine(iteration);
+        }
+
+        guide->training = false;
+        std::cout << "\rPath guiding: " << iteration << " training passes, " << first_sample << " spp, "
+                  << guide->spatial_leaves() << " spatial leaves\n";
+    }
+
+    std::unique_ptr<irradiance_cache> cache;
+    if (use_irradiance_cache && !use_wavefront && !use_bdpt && !use_metropolis && !use_path_guiding && !use_photon_mapping && bounded)
+    {
+        cache.reset(new irradiance_cache(scene_bounds));
+        cache->accuracy = cache_accuracy;
+        cache->min_spacing = cache_min_spacing;
+        cache->max_spacing = cache_max_spacing;
+        cache->theta_strata = cache_probe_strata;
+        cache->phi_strata = 3 * cache_probe_strata;
+        diffuse_cache = cache.get();
+    }
+
+    // ʽӳ䣺ʣµĲֳ֣ÿһ·ӡȾ photon_spp_per_pass С뾶
+    std::unique_ptr<photon_map> caustic_map;
+    if (use_photon_mapping && !use_wavefront && !use_bdpt && !use_metropolis && !lights->empty())
+    {
+        auto radius = photon_radius > 0 ? photon_radius
+                    : bounded ? real(0.005) * (scene_bounds.max() - scene_bounds.min()).length() : real(1);
+        caustic_map.reset(new photon_map(world, *lights, radius));
+        caustics = caustic_map.get();
+        int threads = std::max(1, int(std::thread::hardware_concurrency()));
+
+        int passes = 0;
+        while (first_sample < samples_per_pixel)
+        {
+            std::cout << "\rPhoton mapping: pass " << passes << ", radius " << caustics->radius() << ' ' << std::flush;
+            caustics->trace_pass(photons_per_pass, threads);
+            render_pass(std::min(photon_spp_per_pass, samples_per_pixel - first_sample));
+            caustics->next_pass();
+            passes++;
+        }
+        std::cout << "\rPhoton mapping: " << passes << " passes on " << threads << " threads, "
+                  << caustics->stored() << " caustic photons in the last pass, final radius " << caustics->radius() << "\n";
+    }
+
+    if (use_wavefront)
+    {
+        std::vector<color> image;
+        wavefront_integrator integrator(world, *lights, background, max_depth);
+        integrator.reorder_rays = reorder_rays;
+        integrator.rr_min_depth = rr_min_depth;
+        integrator.next_event = next_event_estimation;
+        auto wavefront_start = std::chrono::steady_clock::now();
+        integrator.render(cam, image_width, image_height, samples_per_pixel, image);
+        std::chrono::duration<double> wavefront_time = std::chrono::steady_clock::now() - wavefront_start;
+        std::cout << "Wavefront: " << integrator.rays_traced << " rays, "
+                  << (integrator.rays_traced / wavefront_time.count()) << " rays/s"
+                  << (reorder_rays ? " (reordered)" : "") << "\n";
+        // ÿһߣľǵĹ
+        path_bounces = integrator.rays_traced - (long long)image_width * image_height * samples_per_pixel;
+        shadow_rays = integrator.shadow_rays_traced;
+        for (int j = image_height - 1; j >= 0; --j)
+            for (int i = 0; i < image_width; ++i)
+                write_color(ppm_file, image[size_t(j) * image_width + i], samples_per_pixel);
+    }
+
+    if (use_bdpt)
+    {
+        std::vector<color> image;
+        bdpt_integrator integrator(world, *lights, background, max_depth);
+        integrator.rr_min_depth = rr_min_depth;
+        integrator.threads = std::max(1, int(std::thread::hardware_concurrency()));
+        integrator.render(cam, image_width, image_height, samples_per_pixel, image);
+        std::cout << "BDPT: " << integrator.threads << " threads, " << integrator.splats << " light tracing splats\n";
+        // ·ĵһ൱
+        path_bounces = integrator.rays_traced - (long long)image_width * image_height * samples_per_pixel;
+        shadow_rays = integrator.shadow_rays_traced;
+        for (int j = image_height - 1; j >= 0; --j)
+            for (int i = 0; i < image_width; ++i)
+                write_color(ppm_file, image[size_t(j) * image_width + i], samples_per_pixel);
+    }
+
+    if (use_metropolis)
+    {
+        std::vector<color> image;
+        metropolis_integrator integrator([&](real x, real y)
+        {
+            return ray_color(cam.get_ray(x / (image_width - 1), y / (image_height - 1)), background, world, *lights, max_depth);
+        });
+        integrator.chains = mlt_chains;
+        integrator.bootstrap_samples = mlt_bootstrap;
+        integrator.large_step_probability = mlt_large_step;
+        integrator.sigma = mlt_sigma;
+        integrator.seed = mlt_seed;
+        integrator.threads = std::max(1, int(std::thread::hardware_concurrency()));
+
+        std::atomic<long long> worker_bounces{ 0 }, worker_shadow_rays{ 0 };
+        integrator.thread_done = [&]()
+        {
+            worker_bounces += path_bounces;
+            worker_shadow_rays += shadow_rays;
+        };
+        integrator.render(image_width, image_height, samples_per_pixel, image);
+        path_bounces = worker_bounces;
+        shadow_rays = worker_shadow_rays;
+
+        std::cout << "Metropolis: " << integrator.chains << " chains on " << integrator.threads << " threads, b = "
+                  << integrator.normalization << ", acceptance " << (100.0 * integrator.accepted / integrator.mutations) << "%\n";
+        for (int j = image_height - 1; j >= 0; --j)
+            for (int i = 0; i < image_width; ++i)
+                write_color(ppm_file, image[size_t(j) * image_width + i], samples_per_pixel);
+    }
+
+    for (int j = image_height - 1; j >= 0 && !use_wavefront && !use_bdpt && !use_metropolis; --j) 
     {
         std::cout << "\rScanlines remaining: " << j << ' ' << std::flush;
+
+        if (use_packets)
+        {
+            // ͬһɨڵɹ߰һ󽻣֮ĵ׷
+            std::vector<color> row(image_width, color(0, 0, 0));
+            if (!pass_image.empty())
+                row.assign(pass_image.begin() + size_t(j) * image_width, pass_image.begin() + size_t(j + 1) * image_width);
+            for (int s = first_sample; s < samples_per_pixel; ++s)
+            {
+                for (int i0 = 0; i0 < image_width; i0 += packet_size)
+                {
+                    ray_packet rp;
+                    real t_max[packet_size];
+                    hit_record recs[packet_size];
+                    unsigned active = 0;
+                    for (int k = 0; k < packet_size; ++k)
+                        t_max[k] = -infinity;       // ûйߵͨκΰΧжཻ
+
+                    for (int k = 0; k < packet_size && i0 + k < image_width; ++k)
+                    {
+                        sampler.start_sample(j * image_width + i0 + k, s);
+                        auto u = (i0 + k + sample_1d(sample_dim::pixel_x)) / (image_width - 1);
+                        auto v = (j + sample_1d(sample_dim::pixel_y)) / (image_height - 1);
+                        rp.set(k, cam.get_ray(u, v));
+                        t_max[k] = infinity;
+                        active |= 1u << k;
+                    }
+
+                    unsigned hits = world.hit_packet(rp, 0.001, t_max, recs, active);
+
+                    for (int k = 0; k < packet_size && i0 + k < image_width; ++k)
+                    {
+                        if (hits >> k & 1)
+                        {
+                            sampler.start_sample(j * image_width + i0 + k, s);
+                            recs[k].resolve(rp.r[k]);
+                            row[i0 + k] += shade(rp.r[k], recs[k], background, world, *lights, max_depth);
+                        }
+                        else
+                            row[i0 + k] += background;
+                    }
+                }
+            }
+            for (int i = 0; i < image_width; ++i)
+                write_color(ppm_file, row[i], samples_per_pixel);
+            continue;
+        }
+
         for (int i = 0; i < image_width; ++i) 
         {
-            color color(0, 0, 0);
-            for (int s = 0; s < samples_per_pixel; ++s) {
-                auto u = (i + random_double()) / (image_width - 1);
-                auto v = (j + random_double()) / (image_height - 1);
+            color color = pass_image.empty() ? vec3(0, 0, 0) : pass_image[size_t(j) * image_width + i];
+            for (int s = first_sample; s < samples_per_pixel; ++s) {
+                sampler.start_sample(j * image_width + i, s);
+                auto u = (i + sample_1d(sample_dim::pixel_x)) / (image_width - 1);
+                auto v = (j + sample_1d(sample_dim::pixel_y)) / (image_height - 1);
                 ray r = cam.get_ray(u, v);
-                color += ray_color(r, background, world, lights, max_depth);
+                color += ray_color(r, background, world, *lights, max_depth);
             }
             write_color(ppm_file, color, samples_per_pixel);
         }
     }
     std::cout << "\nDone.\n";
+    if (diffuse_cache)
+        std::cout << "Irradiance cache: " << diffuse_cache->size() << " records\n";
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    auto total_samples = double(image_width) * image_height * samples_per_pixel;
+    std::cout << "Precision: " << (sizeof(real) == sizeof(float) ? "float" : "double")
+              << ", render time: " << elapsed.count() << " s, "
+              << (total_samples / elapsed.count()) << " samples/s\n";
+    std::cout << "Average path length: " << (1 + path_bounces / total_samples) << " rays + "
+              << (shadow_rays / total_samples) << " shadow rays, "
+              << (elapsed.count() * 1e9 / total_samples) << " ns per sample\n";
 
     ppm_file.flush();
     ppm_file.close();
@@ -432,5 +526,12 @@ int main()
     unsigned char* data = stbi_load(render_target.c_str(), &w, &h, &channel, 0);
     std::string output_image = "image/image.png";
     stbi_write_png(output_image.c_str(), w, h, channel, data, 0);
-
+    stbi_image_free(data);
+
+    // ȷָ򳡾 shared_ptrɳ洢ղ/ͷڴ
+    found_lights.clear();
+    lights.reset();
+    world.clear();
+    if (!current_scene().reset())
+        std::cerr << "Scene arena: " << current_scene().arena.live_allocations() << " objects still alive, not released\n";
 }
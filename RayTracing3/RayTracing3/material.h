@@ -12,14 +12,14 @@ struct scatter_record
     ray specular_ray;
     bool is_specular;
     color attenuation;
-    shared_ptr<pdf> pdf_ptr;
+    scatter_pdf surface_pdf;    // ǾʵɢPDFͱǵֵͣҪѷ
 };
 
 class material 
 {
 public:
     // ɫĬϷغɫ
-    virtual color emitted(const ray& r_in, const hit_record& rec, double u, double v, const point3& p) const
+    virtual color emitted(const ray& r_in, const hit_record& rec, real u, real v, const point3& p) const
     {
         return color(0, 0, 0);
     }
@@ -31,35 +31,75 @@ public:
     }
 
     // ɢܶȺ,ҪԲ
-    virtual double scattering_pdf(const ray& r_in, const hit_record& rec, const ray& scattered) const
+    virtual real scattering_pdf(const ray& r_in, const hit_record& rec, const ray& scattered) const
     {
         return 0;
     }
+
+    // ǾɢĲܶȣ r_in ʱscatter  surface_pdf ȡ direction ܶȡ
+    // ˫򷽷 MIS ҪһԷϼĬϵ scatter ȡɢֲʿֱӸʽ
+    virtual real sampling_pdf(const ray& r_in, const hit_record& rec, const vec3& direction) const
+    {
+        scatter_record srec;
+        if (!scatter(r_in, rec, srec) || srec.is_specular)
+            return 0;
+        return srec.surface_pdf.value(direction);
+    }
+
+    // ǷǹԴռԴбʱʹ
+    virtual bool is_emissive() const
+    {
+        return false;
+    }
+
+    // Ƿ䣬նȻֱֻ
+    virtual bool is_lambertian() const
+    {
+        return false;
+    }
+
+    // ԷĴֵƹԴ
+    virtual color emission() const
+    {
+        return color(0, 0, 0);
+    }
 };
 
 // ʣlambertian
 class lambertian : public material 
 {
 public:
-    lambertian(const vec3& a) : albedo(make_shared<constant_texture>(a)) {}
+    lambertian(const vec3& a) : albedo(arena_make<constant_texture>(a)) {}
     lambertian(shared_ptr<texture> a) : albedo(a) {}
 
     virtual bool scatter(const ray& r_in, const hit_record& rec, scatter_record& srec) const override
     {
         srec.is_specular = false;
         srec.attenuation = albedo->value(rec.u, rec.v, rec.p);
-        srec.pdf_ptr = make_shared<cosine_pdf>(rec.normal);
+        srec.surface_pdf = scatter_pdf::cosine(rec.normal);
 
         return true;
     }
 
     // ɢܶȺ,ҪԲ
-    double scattering_pdf(const ray& r_in, const hit_record& rec, const ray& scattered) const
+    real scattering_pdf(const ray& r_in, const hit_record& rec, const ray& scattered) const
     {
         auto cosine = dot(rec.normal, unit_vector(scattered.direction()));
         return cosine < 0 ? 0 : cosine / pi;
     }
 
+    // ҷֲ䷽޹
+    virtual real sampling_pdf(const ray& r_in, const hit_record& rec, const vec3& direction) const override
+    {
+        auto cosine = dot(rec.normal, unit_vector(direction));
+        return cosine <= 0 ? 0 : cosine / pi;
+    }
+
+    virtual bool is_lambertian() const override
+    {
+        return true;
+    }
+
 public:
     shared_ptr<texture> albedo;
 };
@@ -68,7 +108,7 @@ public:
 class metal : public material 
 {
 public:
-    metal(const vec3& a, double f) : albedo(a), fuzz(f < 1 ? f : 1) {}
+    metal(const vec3& a, real f) : albedo(a), fuzz(f < 1 ? f : 1) {}
 
     virtual bool scatter(const ray& r_in, const hit_record& rec, scatter_record& srec) const override 
     {
@@ -76,14 +116,13 @@ public:
         srec.specular_ray = ray(rec.p, reflected + fuzz * random_in_unit_sphere());
         srec.attenuation = albedo;
         srec.is_specular = true;
-        srec.pdf_ptr = 0;
 
         return true;
     }
 
 public:
     vec3 albedo;
-    double fuzz;    // ģ(ֲ) fuzz=0 ʱģ
+    real fuzz;    // ģ(ֲ) fuzz=0 ʱģ
 };
 
 // Եʣ͸Ĳϣˮʯ
@@ -91,18 +130,17 @@ public:
 class dielectric : public material 
 {
 public:
-    dielectric(double ri) : ref_idx(ri) {}
+    dielectric(real ri) : ref_idx(ri) {}
 
     virtual bool scatter(const ray& r_in, const hit_record& rec, scatter_record& srec) const override
     {
         srec.is_specular = true;
-        srec.pdf_ptr = nullptr;
         srec.attenuation = color(1.0, 1.0, 1.0);
-        double refraction_ratio = (rec.front_face) ? (1.0 / ref_idx) : (ref_idx);
+        real refraction_ratio = (rec.front_face) ? (1.0 / ref_idx) : (ref_idx);
 
         vec3 unit_direction = unit_vector(r_in.direction());
-        double cos_theta = ffmin(dot(-unit_direction, rec.normal), 1.0);
-        double sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+        real cos_theta = ffmin(dot(-unit_direction, rec.normal), 1.0);
+        real sin_theta = sqrt(1.0 - cos_theta * cos_theta);
         
         bool cannot_refract = refraction_ratio * sin_theta > 1.0;
         vec3 direction;
@@ -116,10 +154,10 @@ public:
         return true;
     }
 
-    double ref_idx;     // (涨Ϊ1.0Ϊ1.3-1.7ʯΪ2.4)
+    real ref_idx;     // (涨Ϊ1.0Ϊ1.3-1.7ʯΪ2.4)
 
 private:
-    static double reflectance(double cosine, double ref_idx)
+    static real reflectance(real cosine, real ref_idx)
     {
         // ʹSchlickķʽֵ
         auto r0 = (1 - ref_idx) / (1 + ref_idx);
@@ -134,14 +172,25 @@ class diffuse_light : public material
 {
 public:
     diffuse_light(shared_ptr<texture> a) : emit(a) {}
-    diffuse_light(vec3 c) : emit(make_shared<constant_texture>(c)) {}
+    diffuse_light(vec3 c) : emit(arena_make<constant_texture>(c)) {}
 
     virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const 
     {
         return false;
     }
 
-    virtual vec3 emitted(const ray& r_in, const hit_record& rec, double u, double v, const point3& p) const override
+    virtual bool is_emissive() const override
+    {
+        return true;
+    }
+
+    // Ĵɫ
+    virtual color emission() const override
+    {
+        return emit->value(0.5, 0.5, point3(0, 0, 0));
+    }
+
+    virtual vec3 emitted(const ray& r_in, const hit_record& rec, real u, real v, const point3& p) const override
     {
         if (rec.front_face)
             return emit->value(u, v, p);
@@ -157,7 +206,7 @@ public:
 class isotropic : public material
 {
 public:
-    isotropic(vec3 c) : albedo(make_shared<constant_texture>(c)) {}
+    isotropic(vec3 c) : albedo(arena_make<constant_texture>(c)) {}
     isotropic(shared_ptr<texture> a) : albedo(a) {}
 
     virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const
@@ -171,5 +220,65 @@ public:
     shared_ptr<texture> albedo;
 };
 
+inline bool emits_light(uint32_t mat_id)
+{
+    return current_scene().mat(mat_id).is_emissive();
+}
+
+inline real luminance(const color& c)
+{
+    return real(0.2126) * c.x() + real(0.7152) * c.y() + real(0.0722) * c.z();
+}
+
+inline real emitted_luminance(uint32_t mat_id)
+{
+    return luminance(current_scene().mat(mat_id).emission());
+}
+
+// ֱӹղnext event estimationڷǾĽ㳯Դһ򣬵õһӰ
+// weight  BSDFҡԴPDFʽȨأӰ߻дԷβĹף
+// ͬһҲ BSDF õһȨ·йԴʱ power_heuristic(bsdf, light) 
+// ɢ䷽ֻ BSDF ʱ·scatter_pdf ʵõɢֲ
+inline bool sample_light(const hittable& lights, const ray& r_in, const hit_record& rec,
+                         const scatter_record& srec, const material& mat, ray& shadow, color& weight,
+                         const pdf* scatter_pdf = nullptr)
+{
+    hittable_pdf light_pdf(lights, rec.p);
+    shadow = ray(rec.p, light_pdf.generate(), r_in.time());
+
+    auto light_val = light_pdf.value(shadow.direction());
+    auto scattering = mat.scattering_pdf(r_in, rec, shadow);
+    if (!(light_val > 0) || !(scattering > 0))
+        return false;
+
+    auto mis = power_heuristic(light_val, (scatter_pdf ? *scatter_pdf : srec.surface_pdf).value(shadow.direction()));
+    weight = srec.attenuation * (scattering * mis / light_val);
+    return true;
+}
+
+// Ӱ߻дԷ⡣Դ嵲סʱǵסԷ⣬ͨΪ 0
+inline color shadow_emission(const hittable& world, const ray& shadow)
+{
+    hit_record rec;
+    if (!world.hit(shadow, 0.001, infinity, rec))
+        return color(0, 0, 0);
+
+    rec.resolve(shadow);
+    return current_scene().mat(rec.mat_id).emitted(shadow, rec, rec.u, rec.v, rec.p);
+}
+
+// Դȡĵ㳯һԷ⣬ȡֵ
+inline color sampled_emission(const surface_sample& s)
+{
+    hit_record rec;
+    rec.p = s.p;
+    rec.normal = s.normal;
+    rec.mat_id = s.mat_id;
+    rec.u = s.u;
+    rec.v = s.v;
+    rec.front_face = true;
+    return current_scene().mat(s.mat_id).emitted(ray(s.p + s.normal, -s.normal), rec, s.u, s.v, s.p);
+}
+
 #endif 
 
@@ -0,0 +1,318 @@
+#ifndef MLT_H
+#define MLT_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "rtweekend.h"
+#include "material.h"
+
+// ռ Metropolis ⴫䣨Kelemen et al. 2002Ľṹ PBRT  MLTSampler
+// ·׷ÿһδ X  [0,1)^n ȡֵ·Ĺ׾ X ĺ f(X)
+// ǰάƬϵλáɷ f  I ռߣ󲽱¾
+// Сÿһά̬ŶܸΪ min(1, I() / I())¾״ֵ̬ǽͼ
+// һ b =  I(X) dX һ·ƣbootstrapÿ㰴ȴ·ѡ
+// һʼͷ I ķֲҪԤȽ׶Ρ
+// ŷֳɹ̶飬ÿһ߳ﰴ˳ۼӣٰ˳ӽͼ
+// ˳߳޹أͬһӡͬһ½λһ
+
+// άõʱɻ죬ÿһάϴ޸ʱĵţ
+// һβмɴСŶӣܾʱһָĹάȻָ
+class primary_sample_vector : public random_source
+{
+public:
+    primary_sample_vector(real s, real p) : sigma(s), large_step_probability(p) {}
+
+    void seed(uint32_t s) { rng.seed(s); }
+
+    // µһֱ죬ʾǴ󲽻С
+    void start_iteration()
+    {
+        iteration++;
+        large_step = uniform() < large_step_probability;
+    }
+
+    // ÿμ·ǰӵ 0 άʼȡ
+    void start_path() { index = 0; }
+
+    virtual real next() override
+    {
+        ensure_ready(index);
+        return values[index++].value;
+    }
+
+    void accept()
+    {
+        if (large_step)
+            last_large_step = iteration;
+    }
+
+    void reject()
+    {
+        for (auto& x : values)
+        {
+            if (x.modified == iteration)
+            {
+                x.value = x.backup;
+                x.modified = x.modified_backup;
+            }
+        }
+        iteration--;
+    }
+
+    real uniform() { return real((rng() >> 8) * (1.0 / (1 << 24))); }
+
+private:
+    struct component
+    {
+        real value = 0;
+        real backup = 0;
+        long long modified = -1;        // һ޸һάĵţ-1 ʾûù
+        long long modified_backup = 0;
+    };
+
+    void ensure_ready(size_t i)
+    {
+        if (i >= values.size())
+            values.resize(i + 1);
+        component& x = values[i];
+
+        // һδ֮ûùάȣûùģȲǴδɵֵ
+        // ûùάȲܴ 0 ʼСŶܾrandom_in_unit_disk ȣһֱȡ߽總ֵ
+        if (x.modified < last_large_step)
+        {
+            x.value = uniform();
+            x.modified = last_large_step;
+        }
+
+        x.backup = x.value;
+        x.modified_backup = x.modified;
+        if (large_step)
+        {
+            x.value = uniform();
+        }
+        else
+        {
+            // n ζ̬Ŷ֮ͣ׼Ϊ sigma * sqrt(n) [0,1) β
+            auto n = iteration - x.modified;
+            x.value += normal() * sigma * sqrt(real(n));
+            x.value -= floor(x.value);
+            x.value = ffmin(x.value, real(0.99999994));
+        }
+        x.modified = iteration;
+    }
+
+    // Box-Mullerֻһ std::normal_distribution֤ͬ׼½һ
+    real normal()
+    {
+        auto u1 = 1 - uniform();
+        auto u2 = uniform();
+        return sqrt(-2 * log(u1)) * cos(2 * pi * u2);
+    }
+
+private:
+    real sigma;
+    real large_step_probability;
+    std::mt19937 rng;
+    std::vector<component> values;
+    size_t index = 0;
+    long long iteration = 0;
+    long long last_large_step = 0;
+    bool large_step = true;             // һ·൱һδ󲽣άȶ
+};
+
+class metropolis_integrator
+{
+public:
+    // һ·ĹףƬ (x, y)  [0,width)  [0,height)߶ random_double
+    using path_function = std::function<color(real x, real y)>;
+
+    metropolis_integrator(path_function f) : path(f) {}
+
+    // ͼ image[j * width + i] ţj = 0 һУѭһûг spp
+    void render(int width, int height, int spp, std::vector<color>& image);
+
+public:
+    int bootstrap_samples = 100000;
+    int chains = 1000;
+    int chain_groups = 64;                  // ۼӵķ˳򣬲߳仯
+    real sigma = real(0.01);                // Сı׼
+    real large_step_probability = real(0.3);
+    uint32_t seed = 1;
+    int threads = 1;
+    std::function<void()> thread_done;      // ÿ߳̽ǰãֲ߳̾ͳ
+
+    real normalization = 0;                 // Ƴ b
+    long long mutations = 0;
+    long long accepted = 0;
+
+private:
+    color evaluate(primary_sample_vector& x, int width, int height, int& pixel) const
+    {
+        x.start_path();
+        auto fx = x.next() * width;
+        auto fy = x.next() * height;
+        auto i = std::min(static_cast<int>(fx), width - 1);
+        auto j = std::min(static_cast<int>(fy), height - 1);
+        pixel = j * width + i;
+        return path(fx, fy);
+    }
+
+    // ȫӺŵõһӣͬ bootstrap ·ǵõͬ
+    uint32_t stream_seed(uint32_t index) const
+    {
+        uint32_t x = seed * 0x9e3779b9u ^ (index + 0x7f4a7c15u);
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    //  threads ߳ work(t)߳ t Ϊ tt + threads 񣬻޹
+    template <typename F>
+    void run_threads(F work)
+    {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&, t]()
+            {
+                work(t);
+                if (thread_done)
+                    thread_done();
+            });
+        }
+        for (auto& w : workers)
+            w.join();
+    }
+
+private:
+    path_function path;
+};
+
+void metropolis_integrator::render(int width, int height, int spp, std::vector<color>& image)
+{
+    threads = std::max(threads, 1);
+    chains = std::max(chains, 1);
+    bootstrap_samples = std::max(bootstrap_samples, 1);
+
+    // bootstrapľ·Ȩؾȣǵƽֵ b ƫ
+    std::vector<real> weights(bootstrap_samples);
+    run_threads([&](int t)
+    {
+        auto& source = active_random_source();
+        for (int i = t; i < bootstrap_samples; i += threads)
+        {
+            primary_sample_vector x(sigma, large_step_probability);
+            x.seed(stream_seed(i));
+            source = &x;
+            int pixel;
+            weights[i] = luminance(evaluate(x, width, height, pixel));
+            source = nullptr;
+        }
+    });
+
+    std::vector<real> cdf(bootstrap_samples + 1, 0);
+    for (int i = 0; i < bootstrap_samples; i++)
+        cdf[i + 1] = cdf[i] + ffmax(weights[i], 0);
+    normalization = cdf.back() / bootstrap_samples;
+
+    image.assign(size_t(width) * height, color(0, 0, 0));
+    if (!(normalization > 0))
+        return;
+
+    // ܱȾͬƽָ
+    long long total = (long long)width * height * spp;
+    int groups = std::max(1, std::min(chain_groups, chains));
+    std::vector<std::vector<color>> buffers(threads, std::vector<color>(size_t(width) * height, color(0, 0, 0)));
+    std::vector<long long> accepted_by_thread(threads, 0);
+
+    //  g ǰ鶼ӽͼټӣ֤ŵ˳
+    std::mutex merge_mutex;
+    std::condition_variable merge_done;
+    int merged = 0;
+
+    run_threads([&](int t)
+    {
+        auto& source = active_random_source();
+        auto& buffer = buffers[t];
+        for (int g = t; g < groups; g += threads)
+        {
+            int first = int((long long)chains * g / groups);
+            int last = int((long long)chains * (g + 1) / groups);
+            for (int c = first; c < last; c++)
+            {
+                // ѡһ bootstrap ·Ϊ㣺ͬһ·֮󻻳Լ
+                primary_sample_vector x(sigma, large_step_probability);
+                std::mt19937 chain_rng(stream_seed(uint32_t(bootstrap_samples) + c));
+                auto target = ((chain_rng() >> 8) * (1.0 / (1 << 24))) * cdf.back();
+                auto start = std::upper_bound(cdf.begin() + 1, cdf.end(), target) - cdf.begin() - 1;
+                start = std::min<ptrdiff_t>(start, bootstrap_samples - 1);
+
+                x.seed(stream_seed(uint32_t(start)));
+                source = &x;
+                int current_pixel;
+                color current = evaluate(x, width, height, current_pixel);
+                auto current_i = luminance(current);
+                x.seed(chain_rng());
+
+                long long steps = total / chains + (c < total % chains ? 1 : 0);
+                for (long long k = 0; k < steps; k++)
+                {
+                    x.start_iteration();
+                    int proposed_pixel;
+                    color proposed = evaluate(x, width, height, proposed_pixel);
+                    auto proposed_i = luminance(proposed);
+
+                    auto a = current_i > 0 ? ffmin(1, proposed_i / current_i) : real(1);
+                    if (proposed_i > 0)
+                        buffer[proposed_pixel] += proposed * (a / proposed_i);
+                    if (current_i > 0)
+                        buffer[current_pixel] += current * ((1 - a) / current_i);
+
+                    if (x.uniform() < a)
+                    {
+                        current = proposed;
+                        current_i = proposed_i;
+                        current_pixel = proposed_pixel;
+                        x.accept();
+                        accepted_by_thread[t]++;
+                    }
+                    else
+                    {
+                        x.reject();
+                    }
+                }
+                source = nullptr;
+            }
+
+            std::unique_lock<std::mutex> lock(merge_mutex);
+            merge_done.wait(lock, [&]() { return merged == g; });
+            for (size_t p = 0; p < image.size(); p++)
+                image[p] += buffer[p];
+            merged++;
+            lock.unlock();
+            merge_done.notify_all();
+            std::fill(buffer.begin(), buffer.end(), color(0, 0, 0));
+        }
+    });
+
+    // ÿص = b *  /  * Ȩ֮ͣٳ spp ѭһ
+    auto scale = normalization * (real(width) * height * spp / real(total));
+    for (auto& c : image)
+        c *= scale;
+
+    mutations = total;
+    accepted = 0;
+    for (auto n : accepted_by_thread)
+        accepted += n;
+}
+
+#endif
@@ -9,28 +9,35 @@ class moving_sphere : public hittable
 public:
     moving_sphere() {}
     moving_sphere(
-        vec3 cen0, vec3 cen1, double t0, double t1, double r, shared_ptr<material> m)
+        vec3 cen0, vec3 cen1, real t0, real t1, real r, shared_ptr<material> m)
         : center0(cen0), center1(cen1), time0(t0), time1(t1), radius(r), mat_ptr(m)
     {};
 
-    virtual bool hit(const ray& r, double tmin, double tmax, hit_record& rec) const;
-    virtual bool bounding_box(double t0, double t1, aabb& output_box) const;
+    virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const;
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const;
+    virtual void get_hit_attributes(const ray& r, hit_record& rec) const;
 
-    vec3 center(double time) const;
+    virtual void compile(scene_storage& scene) override
+    {
+        mat_id = scene.add_material(mat_ptr);
+    }
+
+    vec3 center(real time) const;
 
 public:
     vec3 center0, center1;
-    double time0, time1;
-    double radius;
+    real time0, time1;
+    real radius;
     shared_ptr<material> mat_ptr;
+    uint32_t mat_id = 0;            // ±꣬compile ֮Ч
 };
 
-vec3 moving_sphere::center(double time) const 
+vec3 moving_sphere::center(real time) const 
 {
     return center0 + ((time - time0) / (time1 - time0)) * (center1 - center0);
 }
 
-bool moving_sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) const 
+bool moving_sphere::hit(const ray& r, real t_min, real t_max, hit_record& rec) const 
 {
     // ̣ax^2 + bx + c = 0
     vec3 oc = r.origin() - center(r.time());
@@ -48,10 +55,7 @@ bool moving_sphere::hit(const ray& r, double t_min, double t_max, hit_record& re
         if (temp < t_max && temp > t_min) 
         {
             rec.t = temp;
-            rec.p = r.at(rec.t);
-            vec3 outward_normal = (rec.p - center(r.time())) / radius;
-            rec.set_face_normal(r, outward_normal);
-            rec.mat_ptr = mat_ptr;
+            rec.object = this;
             return true;
         }
 
@@ -59,18 +63,23 @@ bool moving_sphere::hit(const ray& r, double t_min, double t_max, hit_record& re
         if (temp < t_max && temp > t_min) 
         {
             rec.t = temp;
-            rec.p = r.at(rec.t);
-            vec3 outward_normal = (rec.p - center(r.time())) / radius;
-            rec.set_face_normal(r, outward_normal);
-            rec.mat_ptr = mat_ptr;
+            rec.object = this;
             return true;
         }
     }
     return false;
 }
 
+void moving_sphere::get_hit_attributes(const ray& r, hit_record& rec) const
+{
+    rec.p = r.at(rec.t);
+    vec3 outward_normal = (rec.p - center(r.time())) / radius;
+    rec.set_face_normal(r, outward_normal);
+    rec.mat_id = mat_id;
+}
+
 // t0ʱ̵İΧУt1ʱ̵İΧУȻټӵİΧ
-bool moving_sphere::bounding_box(double t0, double t1, aabb& output_box) const 
+bool moving_sphere::bounding_box(real t0, real t1, aabb& output_box) const 
 {
     aabb box0(
         center(t0) - vec3(radius, radius, radius),
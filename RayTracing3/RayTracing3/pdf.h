@@ -9,15 +9,15 @@ class pdf
 public:
 	virtual ~pdf() {}
 
-	virtual double value(const vec3& direction) const = 0;
+	virtual real value(const vec3& direction) const = 0;
 	virtual vec3 generate() const = 0;
 };
 
 // ܶȺ
 inline vec3 random_cosine_direction()
 {
-    auto r1 = random_double();
-    auto r2 = random_double();
+    auto r1 = sample_1d(sample_dim::bounce_u);
+    auto r2 = sample_1d(sample_dim::bounce_v);
     auto z = sqrt(1 - r2);
 
     auto phi = 2 * pi * r1;
@@ -27,16 +27,25 @@ inline vec3 random_cosine_direction()
     return vec3(x, y, z);
 }
 
-// ܶ
-class cosine_pdf : public pdf
+// ʵɢֲֵͣ scatter_record Ҫѷ
+// Ŀǰֻ lambertian õҷֲ
+class scatter_pdf : public pdf
 {
-public: 
-    cosine_pdf(const vec3& w) { uvw.build_from_w(w); }
+public:
+    scatter_pdf() {}
+
+    //  w Ϊҷֲlambertian
+    static scatter_pdf cosine(const vec3& w)
+    {
+        scatter_pdf p;
+        p.uvw.build_from_w(w);
+        return p;
+    }
 
-    virtual double value(const vec3& direction) const override
+    virtual real value(const vec3& direction) const override
     {
         auto cosine = dot(unit_vector(direction), uvw.w());
-        return (cosine <= 0) ? 0 : cosine / pi;
+        return cosine <= 0 ? 0 : cosine / pi;
     }
 
     virtual vec3 generate() const override
@@ -49,12 +58,13 @@ public:
 };
 
 // hittableĲ򣬱Դ
+// ֻãΪֵͷջʹãѷ
 class hittable_pdf : public pdf
 {
 public:
-    hittable_pdf(shared_ptr<hittable> p, const point3& origin) : ptr(p), o(origin) {}
+    hittable_pdf(const hittable& p, const point3& origin) : o(origin), ptr(&p) {}
 
-    virtual double value(const vec3& direction) const override
+    virtual real value(const vec3& direction) const override
     {
         return ptr->pdf_value(o, direction);
     }
@@ -66,41 +76,50 @@ public:
 
 public:
     point3 o;
-    shared_ptr<hittable> ptr;
+    const hittable* ptr;
 };
 
 // PDF
 // ҵĻܶȺ͹
+// ǵ÷ջϵֵָֻ룬PDFѷ
 class mixture_pdf : public pdf
 {
 public:
-    mixture_pdf(shared_ptr<pdf> p0, shared_ptr<pdf> p1)
+    mixture_pdf(const pdf& p0, const pdf& p1)
     {
-        p[0] = p0;
-        p[1] = p1;
+        p[0] = &p0;
+        p[1] = &p1;
     }
 
-    virtual double value(const vec3& direction) const override
+    virtual real value(const vec3& direction) const override
     {
         return 0.5 * p[0]->value(direction) + 0.5 * p[1]->value(direction);
     }
 
     virtual vec3 generate() const override
     {
-        if (random_double() < 0.5)
+        if (sample_1d(sample_dim::bounce_choice) < 0.5)
             return p[0]->generate();
         else
             return p[1]->generate();
     }
 
 public:
-    shared_ptr<pdf> p[2];
+    const pdf* p[2];
 };
 
-inline vec3 random_to_sphere(double radius, double distance_squared)
+// ҪԲʽȨأָΪ 2pdf_f ǵõĲԵܶ
+inline real power_heuristic(real pdf_f, real pdf_g)
+{
+    auto f2 = pdf_f * pdf_f;
+    auto g2 = pdf_g * pdf_g;
+    return f2 / (f2 + g2);
+}
+
+inline vec3 random_to_sphere(real radius, real distance_squared)
 {
-    auto r1 = random_double();
-    auto r2 = random_double();
+    auto r1 = sample_1d(sample_dim::bounce_u);
+    auto r2 = sample_1d(sample_dim::bounce_v);
     auto z = 1 + r2 * (sqrt(1 - radius * radius / distance_squared) - 1);
 
     auto phi = 2 * pi * r1;
@@ -1,128 +1,282 @@
 #ifndef PERLIN_H
 #define PERLIN_H
+#include <random>
+#include <vector>
 #include "rtweekend.h"
 
-// ϣ
-class perlin
+// õĹϣݶ
+//  perlin һݣһʹʱɣöɣռȫ
+struct perlin_tables
 {
-public:
-	perlin()
+	static const int point_count = 256;
+
+	// ݶ SoA ţĲļ
+	real ran_x[point_count];
+	real ran_y[point_count];
+	real ran_z[point_count];
+	int perm_x[point_count];
+	int perm_y[point_count];
+	int perm_z[point_count];
+
+	perlin_tables()
 	{
-		ranvec = new vec3[point_count];		
+		std::mt19937 rng(20200807);
+		std::uniform_real_distribution<real> dist(-1, 1);
 
 		for (int i = 0; i < point_count; ++i)
 		{
-			ranvec[i] = unit_vector(vec3::random(-1, 1));
+			auto g = unit_vector(vec3(dist(rng), dist(rng), dist(rng)));
+			ran_x[i] = g.x();
+			ran_y[i] = g.y();
+			ran_z[i] = g.z();
 		}
 
-		perm_x = perlin_generate_perm();
-		perm_y = perlin_generate_perm();
-		perm_z = perlin_generate_perm();
+		generate_perm(perm_x, rng);
+		generate_perm(perm_y, rng);
+		generate_perm(perm_z, rng);
 	}
 
-	~perlin()
+	static void generate_perm(int* p, std::mt19937& rng)
 	{
-		delete[] ranvec;
-		delete[] perm_x;
-		delete[] perm_y;
-		delete[] perm_z;
+		for (int i = 0; i < point_count; i++)
+		{
+			p[i] = i;
+		}
+
+		for (int i = point_count - 1; i > 0; i--)
+		{
+			int target = std::uniform_int_distribution<int>(0, i)(rng);
+			int tmp = p[i];
+			p[i] = p[target];
+			p[target] = tmp;
+		}
 	}
+};
+
+inline const perlin_tables& shared_perlin_tables()
+{
+	static const perlin_tables tables;
+	return tables;
+}
+
+// 
+class perlin
+{
+public:
+	// noise_packet һμĵһ 16 ֽ SIMD Ĵfloat 4 double 2 
+	// double Ҳ 4 ʱҪĴʵⷴ
+	static const int lanes = 16 / sizeof(real);
+
+	perlin() : t(shared_perlin_tables()) {}
 
 	// ʹԲֵİ
-	double noise(const vec3& p) const
+	real noise(const vec3& p) const
 	{
-		auto u = p.x() - floor(p.x());
-		auto v = p.y() - floor(p.y());
-		auto w = p.z() - floor(p.z());
-		auto i = static_cast<int>(floor(p.x()));
-		auto j = static_cast<int>(floor(p.y()));
-		auto k = static_cast<int>(floor(p.z()));
-		vec3 c[2][2][2];
-
-		for (int di = 0; di < 2; di++)
-			for (int dj = 0; dj < 2; dj++)
-				for (int dk = 0; dk < 2; dk++)
-					c[di][dj][dk] = ranvec[
-							perm_x[(i + di) & 255] ^
-							perm_y[(j + dj) & 255] ^
-							perm_z[(k + dk) & 255]
-					];
+		real x = p.x(), y = p.y(), z = p.z(), out;
+		noise_n<1>(&x, &y, &z, &out);
+		return out;
+	}
 
-		return trilinear_interp(c, u, v, w);
+	// һμ lanes 갴 SoA 
+	void noise_packet(const real* x, const real* y, const real* z, real* out) const
+	{
+		noise_n<lanes>(x, y, z, out);
 	}
 
 	// Ŷ(turbulence)Ƶӵõĸ
-	double turb(const vec3& p, int depth = 7) const
+	// ÿ lanes Ƶһ齻 noise_packet һ
+	real turb(const vec3& p, int depth = 7) const
 	{
-		auto accum = 0.0;
-		vec3 temp_p = p;
-		auto weight = 1.0;
+		real accum = 0;
+		real weight = 1;
+		real scale = 1;
 
-		for (int i = 0; i < depth; i++)
+		for (int i0 = 0; i0 < depth; i0 += lanes)
 		{
-			accum += weight * noise(temp_p);
-			weight *= 0.5;
-			temp_p *= 2;
+			real x[lanes], y[lanes], z[lanes], n[lanes];
+			for (int l = 0; l < lanes; l++)
+			{
+				x[l] = scale * p.x();
+				y[l] = scale * p.y();
+				z[l] = scale * p.z();
+				scale *= 2;
+			}
+
+			noise_packet(x, y, z, n);
+
+			for (int l = 0; l < lanes && i0 + l < depth; l++)
+			{
+				accum += weight * n[l];
+				weight *= 0.5;
+			}
 		}
 		return fabs(accum);
 	}
 
 private:
-	static const int point_count = 256;
-	vec3* ranvec;							// ݶĲļ
-	int* perm_x;
-	int* perm_y;
-	int* perm_z;
-
-	static int* perlin_generate_perm()
+	// N ÿһǶ N ͨͬ㡢ûз֧
+	// ԰Ѳֵֻвͨ
+	template <int N>
+	void noise_n(const real* x, const real* y, const real* z, real* out) const
 	{
-		auto p = new int[point_count];
+		int px[2][N], py[2][N], pz[2][N];
+		real du[2][N], dv[2][N], dw[2][N];		// ƫ u - di
+		real wu[2][N], wv[2][N], ww[2][N];		// ĲֵȨ
 
-		for(int i = 0; i < perlin::point_count; i++)
+		for (int l = 0; l < N; l++)
 		{
-			p[i] = i;
+			// ȡضϺԸһͨ floor
+			auto i = static_cast<int>(x[l]);
+			auto j = static_cast<int>(y[l]);
+			auto k = static_cast<int>(z[l]);
+			i -= x[l] < i;
+			j -= y[l] < j;
+			k -= z[l] < k;
+			auto u = x[l] - i;
+			auto v = y[l] - j;
+			auto w = z[l] - k;
+
+			// ÿֻҪû8 ǵĹϣõ
+			px[0][l] = t.perm_x[i & 255];
+			px[1][l] = t.perm_x[(i + 1) & 255];
+			py[0][l] = t.perm_y[j & 255];
+			py[1][l] = t.perm_y[(j + 1) & 255];
+			pz[0][l] = t.perm_z[k & 255];
+			pz[1][l] = t.perm_z[(k + 1) & 255];
+
+			// մ(Mach bands)Ա仯ɫɵӾ֪Ч
+			// hermite cubeƽֵ
+			auto uu = u * u * (3 - 2 * u);
+			auto vv = v * v * (3 - 2 * v);
+			auto ws = w * w * (3 - 2 * w);
+			wu[0][l] = 1 - uu; wu[1][l] = uu;
+			wv[0][l] = 1 - vv; wv[1][l] = vv;
+			ww[0][l] = 1 - ws; ww[1][l] = ws;
+			du[0][l] = u; du[1][l] = u - 1;
+			dv[0][l] = v; dv[1][l] = v - 1;
+			dw[0][l] = w; dw[1][l] = w - 1;
+			out[l] = 0;
 		}
 
-		permute(p, point_count);
+		// Բֵ8 ۼӣͨȡݶȣٶͨһͼȨ
+		for (int di = 0; di < 2; di++)
+			for (int dj = 0; dj < 2; dj++)
+				for (int dk = 0; dk < 2; dk++)
+				{
+					real gx[N], gy[N], gz[N];
+					for (int l = 0; l < N; l++)
+					{
+						auto h = px[di][l] ^ py[dj][l] ^ pz[dk][l];
+						gx[l] = t.ran_x[h];
+						gy[l] = t.ran_y[h];
+						gz[l] = t.ran_z[h];
+					}
 
-		return p;
+					for (int l = 0; l < N; l++)
+					{
+						out[l] += wu[di][l] * wv[dj][l] * ww[dk][l]
+							   *  (gx[l] * du[di][l] + gy[l] * dv[dj][l] + gz[l] * dw[dk][l]);
+					}
+				}
 	}
 
-	static void permute(int* p, int n)
+	const perlin_tables& t;
+};
+
+// ԤȺ決Ŷ
+// һΧڰ n^3 㱣 turb ֵѯʱԲֵÿμ 7 Ƶ
+// ֱʵ߱Ƶʱᶪʧϸڣ measure_error 
+class turbulence_grid
+{
+public:
+	void bake(const perlin& noise, const point3& box_min, const point3& box_max, int res)
 	{
-		for (int i = n - 1; i > 0; i--)
+		n = res < 2 ? 2 : res;
+		lo = box_min;
+		hi = box_max;
+		for (int a = 0; a < 3; a++)
 		{
-			int target = random_int(0, i);
-			int tmp = p[i];
-			p[i] = p[target];
-			p[target] = tmp;
+			auto extent = hi[a] - lo[a];
+			step[a] = extent > 0 ? extent / (n - 1) : 0;
+			inv_step[a] = extent > 0 ? (n - 1) / extent : 0;
 		}
+
+		values.resize(size_t(n) * n * n);
+		for (int k = 0; k < n; k++)
+			for (int j = 0; j < n; j++)
+				for (int i = 0; i < n; i++)
+				{
+					point3 p(lo.x() + i * step[0], lo.y() + j * step[1], lo.z() + k * step[2]);
+					values[index(i, j, k)] = static_cast<float>(noise.turb(p));
+				}
+	}
+
+	bool empty() const { return values.empty(); }
+	size_t bytes() const { return values.size() * sizeof(float); }
+
+	bool contains(const point3& p) const
+	{
+		return p.x() >= lo.x() && p.x() <= hi.x()
+			&& p.y() >= lo.y() && p.y() <= hi.y()
+			&& p.z() >= lo.z() && p.z() <= hi.z();
 	}
 
-	// Բֵȥƽ
-	static double trilinear_interp(vec3 c[2][2][2], double u, double v, double w)
+	// Բֵp ڰΧ
+	real lookup(const point3& p) const
 	{
-		// մ(Mach bands)Ա仯ɫɵӾ֪Ч
-		// hermite cubeƽֵ
-		auto uu = u * u * (3 - 2 * u);
-		auto vv = v * v * (3 - 2 * v);
-		auto ww = w * w * (3 - 2 * w);
-		auto accum = 0.0;
-
-		for (int i = 0; i < 2; i++)
-			for (int j = 0; j < 2; j++)
-				for (int k = 0; k < 2; k++)
+		int c[3];
+		real f[3];
+		for (int a = 0; a < 3; a++)
+		{
+			auto x = (p[a] - lo[a]) * inv_step[a];
+			c[a] = static_cast<int>(x);
+			if (c[a] > n - 2)
+				c[a] = n - 2;
+			f[a] = x - c[a];
+		}
+
+		real accum = 0;
+		for (int di = 0; di < 2; di++)
+			for (int dj = 0; dj < 2; dj++)
+				for (int dk = 0; dk < 2; dk++)
 				{
-					vec3 weight_v(u - i, v - j, w - k);
-					accum += (i * uu + (1 - i) * (1 - uu)) 
-						  *  (j * vv + (1 - j) * (1 - vv)) 
-						  *  (k * ww + (1 - k) * (1 - ww)) 
-						  *  dot(c[i][j][k], weight_v);
+					accum += (di ? f[0] : 1 - f[0])
+						   * (dj ? f[1] : 1 - f[1])
+						   * (dk ? f[2] : 1 - f[2])
+						   * values[index(c[0] + di, c[1] + dj, c[2] + dk)];
 				}
-					
 		return accum;
 	}
 
+	// ڰΧȡ㣬ֱӼ turb Ƚϣõ;
+	// öӰȾ
+	void measure_error(const perlin& noise, int samples, real& max_error, real& rms_error) const
+	{
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<real> dist(0, 1);
+		real sum_sq = 0;
+		max_error = 0;
+
+		for (int s = 0; s < samples; s++)
+		{
+			point3 p(lo.x() + dist(rng) * (hi.x() - lo.x()),
+					 lo.y() + dist(rng) * (hi.y() - lo.y()),
+					 lo.z() + dist(rng) * (hi.z() - lo.z()));
+			auto e = fabs(lookup(p) - noise.turb(p));
+			max_error = ffmax(max_error, e);
+			sum_sq += e * e;
+		}
+		rms_error = sqrt(sum_sq / samples);
+	}
+
+private:
+	size_t index(int i, int j, int k) const { return (size_t(k) * n + j) * n + i; }
+
+	std::vector<float> values;
+	int n = 0;
+	point3 lo, hi;
+	real step[3];
+	real inv_step[3];
 };
 
 #endif
@@ -0,0 +1,224 @@
+#ifndef PHOTON_MAP_H
+#define PHOTON_MAP_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "rtweekend.h"
+#include "hittable.h"
+#include "material.h"
+#include "light_list.h"
+
+// ɢͼJensen 1996뾶ʽӳ䣨Knaus & Zwicker 2011С
+// ÿһִӹԴ̶Ĺӣֻһξ淴/䵽ĹӣL S+ D
+// Ԫš·䶥ѯ뾶 r ڵĹܶȹƣ
+// Լҵ D S+ L Է򶪵ظ㡣ÿֽ r^2  (i + ) / (i + 1)
+// ֵƽֵƫͷ 0ÿ̶ֹظʹãڴ治
+struct photon
+{
+    point3 p;
+    vec3 direction;     // ӵǰ򣨵λ
+    color power;        // ûгԱַĹ
+};
+
+class photon_map
+{
+public:
+    photon_map(const hittable& w, const light_list& l, real initial_radius)
+        : world(w), lights(l), radius2(initial_radius * initial_radius) {}
+
+    // µһ֣threads ̸߳Էһֹӣٽ
+    void trace_pass(size_t count, int threads);
+
+    // һֵȾС뾶
+    void next_pass()
+    {
+        radius2 *= (pass + alpha) / (pass + 1);
+        pass++;
+    }
+
+    // 佻㴦ɽɢ -r_in ȥķ
+    color gather(const ray& r_in, const hit_record& rec, const scatter_record& srec, const material& mat) const;
+
+    real radius() const { return sqrt(radius2); }
+    size_t stored() const { return photons.size(); }
+
+public:
+    real alpha = real(2) / 3;       // ÿֱĹӱԽС뾶СԽ
+    int max_depth = 16;
+
+private:
+    void trace_photons(size_t count, std::vector<photon>& out) const;
+    void build_grid();
+
+    void cell_of(const point3& p, int c[3]) const
+    {
+        for (int a = 0; a < 3; a++)
+            c[a] = static_cast<int>(floor(p[a] / cell_size));
+    }
+
+    uint32_t cell_hash(int x, int y, int z) const
+    {
+        return (uint32_t(x) * 73856093u ^ uint32_t(y) * 19349663u ^ uint32_t(z) * 83492791u) & table_mask;
+    }
+
+private:
+    const hittable& world;
+    const light_list& lights;
+    real radius2;
+    int pass = 0;
+    size_t emitted = 0;
+
+    std::vector<std::vector<photon>> thread_photons;    // ÿ߳һִµĹ
+    std::vector<photon> photons;                        // Ԫź
+    std::vector<uint32_t> cell_start;                   //  i ԪĹ [cell_start[i], cell_start[i + 1])
+    std::vector<uint32_t> cursor;
+    real cell_size = 1;
+    uint32_t table_mask = 0;
+};
+
+void photon_map::trace_pass(size_t count, int threads)
+{
+    threads = std::max(threads, 1);
+    thread_photons.resize(threads);
+    emitted = count;
+
+    // ߳ûлĲʵ߶ø߳Լ random_double
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        auto n = count / threads + (size_t(t) < count % threads ? 1 : 0);
+        workers.emplace_back([this, t, n, threads]()
+        {
+            seed_random(uint32_t(pass) * uint32_t(threads) + uint32_t(t) + 1);
+            thread_photons[t].clear();
+            trace_photons(n, thread_photons[t]);
+        });
+    }
+    for (auto& w : workers)
+        w.join();
+
+    build_grid();
+}
+
+void photon_map::trace_photons(size_t count, std::vector<photon>& out) const
+{
+    if (lights.empty())
+        return;
+
+    for (size_t k = 0; k < count; k++)
+    {
+        // ѡԴڱϾȡ㣬ҷֲ = Le *  / (ѡи * ܶ)
+        auto index = lights.pick(random_double());
+        surface_sample s;
+        if (!lights.lights[index]->sample_point(s))
+            continue;
+
+        onb uvw;
+        uvw.build_from_w(s.normal);
+        ray r(s.p, uvw.local(random_cosine_direction()), random_double());
+        color power = sampled_emission(s) * (pi / (lights.select_pdf[index] * s.area_pdf));
+
+        bool specular = false;
+        for (int depth = 0; depth < max_depth; depth++)
+        {
+            hit_record rec;
+            if (!world.hit(r, 0.001, infinity, rec))
+                break;
+            rec.resolve(r);
+
+            scatter_record srec;
+            if (!current_scene().mat(rec.mat_id).scatter(r, rec, srec))
+                break;
+
+            // ֱյĹɹԴֻнɢŴ
+            if (!srec.is_specular)
+            {
+                if (specular)
+                    out.push_back({ rec.p, unit_vector(r.direction()), power });
+                break;
+            }
+
+            specular = true;
+            power = power * srec.attenuation;
+            r = srec.specular_ray;
+        }
+    }
+}
+
+// Ԫ߳ȡֱ 2rѯ 2x2x2 ԪϣĴСȡСڹ 2 
+void photon_map::build_grid()
+{
+    size_t n = 0;
+    for (const auto& v : thread_photons)
+        n += v.size();
+
+    uint32_t table = 1;
+    while (table < 2 * n)
+        table <<= 1;
+    table_mask = table - 1;
+    cell_size = 2 * radius();
+
+    cell_start.assign(table + 1, 0);
+    int c[3];
+    for (const auto& v : thread_photons)
+        for (const auto& ph : v)
+        {
+            cell_of(ph.p, c);
+            cell_start[cell_hash(c[0], c[1], c[2]) + 1]++;
+        }
+    for (uint32_t i = 0; i < table; i++)
+        cell_start[i + 1] += cell_start[i];
+
+    cursor.assign(cell_start.begin(), cell_start.end() - 1);
+    photons.resize(n);
+    for (const auto& v : thread_photons)
+        for (const auto& ph : v)
+        {
+            cell_of(ph.p, c);
+            photons[cursor[cell_hash(c[0], c[1], c[2])]++] = ph;
+        }
+}
+
+color photon_map::gather(const ray& r_in, const hit_record& rec, const scatter_record& srec, const material& mat) const
+{
+    if (photons.empty())
+        return color(0, 0, 0);
+
+    auto r = radius();
+    int c[3];
+    cell_of(rec.p - vec3(r, r, r), c);
+
+    // ͬĵԪܹϣͬһλãͬһλֻһ
+    uint32_t visited[8];
+    int visited_count = 0;
+    color sum(0, 0, 0);
+
+    for (int i = 0; i < 8; i++)
+    {
+        auto key = cell_hash(c[0] + (i & 1), c[1] + (i >> 1 & 1), c[2] + (i >> 2));
+        if (std::find(visited, visited + visited_count, key) != visited + visited_count)
+            continue;
+        visited[visited_count++] = key;
+
+        for (auto k = cell_start[key]; k < cell_start[key + 1]; k++)
+        {
+            const photon& ph = photons[k];
+            if ((ph.p - rec.p).length_squared() > radius2)
+                continue;
+
+            // ӱһĹղһ
+            auto cos_theta = -dot(ph.direction, rec.normal);
+            if (!(cos_theta > 0))
+                continue;
+
+            // BRDF = ˥ * ɢPDF / cos
+            ray wi(rec.p, -ph.direction, r_in.time());
+            sum += ph.power * (mat.scattering_pdf(r_in, rec, wi) / cos_theta);
+        }
+    }
+
+    return srec.attenuation * sum / (pi * radius2 * emitted);
+}
+
+#endif
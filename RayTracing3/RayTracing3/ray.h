@@ -7,22 +7,22 @@
 class ray {
 public:
     ray() {}
-    ray(const vec3& origin, const vec3& direction, double time = 0.0)
+    ray(const vec3& origin, const vec3& direction, real time = 0.0)
         : orig(origin), dir(direction), tm(time)
     {}
 
     vec3 origin() const { return orig; }
     vec3 direction() const { return dir; }
-    double time() const { return tm; }
+    real time() const { return tm; }
 
     // p(t) = a + tb
-    vec3 at(double t) const {
+    vec3 at(real t) const {
         return orig + t * dir;
     }
 
 public:
     vec3 orig;  // ԭ
     vec3 dir;   // ߷
-    double tm;  // Լʱ
+    real tm;  // Լʱ
 };
 #endif
@@ -0,0 +1,28 @@
+#ifndef RAY_PACKET_H
+#define RAY_PACKET_H
+
+#include "rtweekend.h"
+
+// ߰ص߸߶һ£һBVHڵİΧв
+const int packet_size = 8;
+const unsigned packet_full_mask = (1u << packet_size) - 1;
+
+struct ray_packet
+{
+    // ΧвԶٰͨȡһʱŵͨҲᱻ
+    ray r[packet_size];                     // ԭʼߣҶӽڵʱʹ
+    real orig[3][packet_size] = {};         // SoA ֵ㣬Χв
+    real inv_dir[3][packet_size] = {};      // ĵ
+
+    void set(int i, const ray& ray_i)
+    {
+        r[i] = ray_i;
+        for (int a = 0; a < 3; a++)
+        {
+            orig[a][i] = ray_i.origin()[a];
+            inv_dir[a][i] = 1 / ray_i.direction()[a];
+        }
+    }
+};
+
+#endif
@@ -2,10 +2,11 @@
 #define RTWEEKEND_H
 
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <limits>
 #include <memory>
-#include <cstdlib>
+#include <random>
 
 // õĳ͹
 // Usings
@@ -13,29 +14,63 @@
 using std::shared_ptr;
 using std::make_shared;
 
+// ͣʱ RT_USE_FLOAT ѧģvec3rayaabbͼԪʹ float
+// ʹ doubleͬһԴԹ־ȵȾ
+#ifdef RT_USE_FLOAT
+using real = float;
+#else
+using real = double;
+#endif
+
 // Constants
 
-const double infinity = std::numeric_limits<double>::infinity();    // 
-const double pi = 3.1415926535897932385;
+const real infinity = std::numeric_limits<real>::infinity();    // 
+const real pi = real(3.1415926535897932385);
 
 // Utility Functions
 
-inline double degrees_to_radians(double degrees) {
+inline real degrees_to_radians(real degrees) {
     return degrees * pi / 180;
 }
 
-inline double ffmin(double a, double b) { return a <= b ? a : b; }
-inline double ffmax(double a, double b) { return a >= b ? a : b; }
+inline real ffmin(real a, real b) { return a <= b ? a : b; }
+inline real ffmax(real a, real b) { return a >= b ? a : b; }
 
-inline double clamp(double x, double min, double max) {
+inline real clamp(real x, real min, real max) {
     if (x < min) return min;
     if (x > max) return max;
     return x;
 }
 
+// ÿ߳Լrand() ȫ״̬ڶ߳»ãҲ̵߳й
+inline std::mt19937& random_generator() {
+    thread_local std::mt19937 generator;
+    return generator;
+}
+
+// 趨ǰ̵߳ӣ̰߳Լı趨޹
+inline void seed_random(uint32_t seed) {
+    random_generator().seed(seed);
+}
+
+// ԴĬø߳Լ random_generatorMetropolis ⴫
+// ·ϵÿһߣûеͲʱ sample_1d ģδȡֵ
+class random_source {
+public:
+    virtual ~random_source() {}
+    virtual real next() = 0;    // [0,1) еһ
+};
+
+inline random_source*& active_random_source() {
+    thread_local random_source* source = nullptr;
+    return source;
+}
+
 inline double random_double() {
     // Returns a random real in [0,1).
-    return rand() / (RAND_MAX + 1.0);
+    if (auto s = active_random_source())
+        return s->next();
+    return random_generator()() * (1.0 / 4294967296.0);
 }
 
 inline double random_double(double min, double max) {
@@ -53,5 +88,6 @@ inline int random_int(int min, int max) {
 #include "ray.h"
 #include "vec3.h"
 #include "onb.h"
+#include "sampler.h"
 
 #endif
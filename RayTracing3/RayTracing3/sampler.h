@@ -0,0 +1,268 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <cstdint>
+#include "rtweekend.h"
+
+// ͲOwen ҵ Sobol УBurley 2020, "Practical Hash-based Owen Scrambling"
+// ÿ߶й̶άȣضͷʱ䡢ÿεĻѡ/Դѡ/򣩣
+// ͬһصĵ i ÿάȡҺ Sobol еĵ i 㣬ȶ
+// άȰ 4 һ飺ÿһ 4 ά Sobol 㣬֮òͬӴźλ
+// ֻҪǰ 4 άķε䶼иԲصά
+// ģʽAhmed & Wonka 2020͵һεļ鲻ÿضң
+//  64x64 ͼ鹲һУذ Morton ˳ȡһ
+// صȻǷֲõĵ㼯ಹͲʱ㼯ڸƵ
+
+// ά
+enum class sample_dim : int
+{
+    pixel_x,            //  0 飺ڵĶ;ͷλ
+    pixel_y,
+    lens_u,
+    lens_v,
+    time,               //  1 飺ʱ
+    bounce_choice,      //  2 + 2 * bounce 飺PDFѡһѡĸԴɢ䷽
+                        //  3 + 2 * bounce 飺ͬһεֱӹղõά
+    bounce_light,
+    bounce_u,
+    bounce_v,
+};
+
+class sobol_sampler
+{
+public:
+    // ʼһرź͸ڵžάȵȡֵ
+    void start_sample(uint32_t pixel, uint32_t index)
+    {
+        auto x = pixel % image_width;
+        auto y = pixel / image_width;
+        tile_seed = hash((y / tile_size) * 65536 + x / tile_size);
+        tile_offset = morton(x % tile_size, y % tile_size);
+        pixel_seed = hash(pixel ^ hash(seed));
+        sample_index = index;
+        stage = 0;
+        cached_group = ~0u;
+    }
+
+    // light_sample Ϊ true ʱεֱӹ飬Դɢ䷽øά
+    void set_bounce(int b, bool light_sample = false) { stage = 2 * b + (light_sample ? 1 : 0); }
+
+    real get(sample_dim d)
+    {
+        auto dim = static_cast<int>(d);
+        uint32_t group, component;
+        if (dim < static_cast<int>(sample_dim::time))
+        {
+            group = 0;
+            component = dim;
+        }
+        else if (d == sample_dim::time)
+        {
+            group = 1;
+            component = 0;
+        }
+        else
+        {
+            group = 2 + stage;
+            component = dim - static_cast<int>(sample_dim::bounce_choice);
+        }
+
+        // ͬһĸάͬŴңڵķֲ㣻Һڸ
+        if (group != cached_group)
+        {
+            cached_group = group;
+            if (blue_noise && (group == 0 || group == 2 || group == 3))
+            {
+                // Сȡ 2 ݣÿصжһΣҲǷֲ
+                uint32_t block = 1;
+                while (block < samples_per_pixel)
+                    block <<= 1;
+                group_seed = hash_combine(hash(seed) ^ tile_seed, group);
+                shuffled_index = nested_uniform_scramble(tile_offset * block + sample_index, group_seed);
+            }
+            else
+            {
+                group_seed = hash_combine(pixel_seed, group);
+                shuffled_index = nested_uniform_scramble(sample_index, group_seed);
+            }
+        }
+        auto x = nested_uniform_scramble(sobol(shuffled_index, component), hash_combine(group_seed, component));
+
+        // ȡ 24 λfloat ҲϸС 1
+        return (x >> 8) * real(1.0 / (1 << 24));
+    }
+
+public:
+    uint32_t seed = 0;              // ȫӣһӵõһ鲻ص
+    bool blue_noise = false;        // ͵һεάȰص Morton ˳һ
+    uint32_t image_width = 1;       // ر
+    uint32_t samples_per_pixel = 1;
+
+private:
+    static const uint32_t tile_size = 64;
+
+    // ͼص Morton ţڵıĻҲ
+    static uint32_t morton(uint32_t x, uint32_t y)
+    {
+        uint32_t m = 0;
+        for (int bit = 0; bit < 6; bit++)
+            m |= (x >> bit & 1) << (2 * bit) | (y >> bit & 1) << (2 * bit + 1);
+        return m;
+    }
+
+    // ǰ 4 άɾ󣬰ŵÿֽԤãһֻҪ 4 α
+    struct sobol_tables
+    {
+        uint32_t bytes[4][4][256];
+
+        sobol_tables()
+        {
+            //  0 ά van der Corput У Joe-Kuo ıԭʽ
+            uint32_t v[4][32];
+            const uint32_t s[3] = { 1, 2, 3 };
+            const uint32_t a[3] = { 0, 1, 1 };
+            const uint32_t m[3][3] = { { 1 }, { 1, 3 }, { 1, 3, 1 } };
+
+            for (int i = 0; i < 32; i++)
+                v[0][i] = 1u << (31 - i);
+
+            for (int d = 1; d < 4; d++)
+            {
+                auto sd = s[d - 1];
+                for (uint32_t i = 0; i < 32; i++)
+                {
+                    if (i < sd)
+                    {
+                        v[d][i] = m[d - 1][i] << (31 - i);
+                        continue;
+                    }
+                    v[d][i] = v[d][i - sd] ^ (v[d][i - sd] >> sd);
+                    for (uint32_t k = 1; k < sd; k++)
+                        v[d][i] ^= ((a[d - 1] >> (sd - 1 - k)) & 1) * v[d][i - k];
+                }
+            }
+
+            for (int d = 0; d < 4; d++)
+                for (int b = 0; b < 4; b++)
+                    for (uint32_t n = 0; n < 256; n++)
+                    {
+                        uint32_t x = 0;
+                        for (int bit = 0; bit < 8; bit++)
+                        {
+                            if (n >> bit & 1)
+                                x ^= v[d][b * 8 + bit];
+                        }
+                        bytes[d][b][n] = x;
+                    }
+        }
+    };
+
+    static uint32_t sobol(uint32_t index, uint32_t dim)
+    {
+        static const sobol_tables t;
+        const auto& m = t.bytes[dim];
+        return m[0][index & 0xff] ^ m[1][index >> 8 & 0xff] ^ m[2][index >> 16 & 0xff] ^ m[3][index >> 24];
+    }
+
+    static uint32_t reverse_bits(uint32_t x)
+    {
+        x = (x << 16) | (x >> 16);
+        x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+        x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+        x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+        x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+        return x;
+    }
+
+    // Laine-Karras ûÿһλֻܸλӰ죬ڷתλϾ Owen 
+    static uint32_t laine_karras_permutation(uint32_t x, uint32_t seed)
+    {
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return x;
+    }
+
+    static uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed)
+    {
+        return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+    }
+
+    static uint32_t hash(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    static uint32_t hash_combine(uint32_t seed, uint32_t v)
+    {
+        return seed ^ (hash(v) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+    }
+
+private:
+    uint32_t pixel_seed = 0;
+    uint32_t tile_seed = 0;         // ģʽͼ
+    uint32_t tile_offset = 0;       // ģʽͼڵ Morton 
+    uint32_t sample_index = 0;
+    uint32_t stage = 0;             // 2 * ֱӹղʱټ 1
+    uint32_t cached_group = ~0u;    // shuffled_index һ
+    uint32_t group_seed = 0;
+    uint32_t shuffled_index = 0;
+};
+
+// ǰ߳ʹõĲnullptr ʾάȶ random_double
+inline sobol_sampler*& active_sampler()
+{
+    thread_local sobol_sampler* sampler = nullptr;
+    return sampler;
+}
+
+// ڰѵǰ̵߳Ĳ snullptr ʾö뿪ʱָ
+class sampler_scope
+{
+public:
+    explicit sampler_scope(sobol_sampler* s) : previous(active_sampler()) { active_sampler() = s; }
+    ~sampler_scope() { active_sampler() = previous; }
+
+    sampler_scope(const sampler_scope&) = delete;
+    sampler_scope& operator=(const sampler_scope&) = delete;
+
+private:
+    sobol_sampler* previous;
+};
+
+// ȡĳһάлĲʱ Sobol 㣬˻ random_double
+// random_double  double 1 - 2^-32float ת real  1ԽصС 1  float
+inline real sample_1d(sample_dim d)
+{
+    if (auto s = active_sampler())
+        return s->get(d);
+    return ffmin(real(random_double()), real(0.99999994));
+}
+
+inline real sample_1d(sample_dim d, real min, real max)
+{
+    return min + (max - min) * sample_1d(d);
+}
+
+//  [min,max] ȡһfloat  min + (max + 1 - min) * u Կ max + 1
+inline int sample_int(sample_dim d, int min, int max)
+{
+    auto i = static_cast<int>(sample_1d(d, min, max + 1));
+    return i > max ? max : i;
+}
+
+// ֪ͨڼε䣬֮ĵάȻӦ
+inline void sample_bounce(int bounce, bool light_sample = false)
+{
+    if (auto s = active_sampler())
+        s->set_bounce(bounce, light_sample);
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "rtweekend.h"
+#include "arena.h"
+
+class material;
+
+// 洢ʵ±ͼԪ hit_record ֻ 32 λ±
+// ʱ shared_ptr 󣬹캯֮ hittable::compile һ world
+// ͼԪѲʵǼǽ±ꡣ shared_ptr ֻڵǼʱһΣʱд hit_record ֻǿһ
+// ԭüǶ̬󣬲һʼָһμӷʣ麯ҲҪһΣ
+// ֻãֱͨ shared_ptr ʣòüҪ±ꡣ
+// ͼԪBVH Ҷӣtyped_listͰֵǡ
+//  arena 
+class scene_storage
+{
+public:
+    // ڳڴﴴ
+    template <typename T, typename... Args>
+    shared_ptr<T> make(Args&&... args)
+    {
+        return arena.make<T>(std::forward<Args>(args)...);
+    }
+
+    // ͬһֻǼһΣͼԪͬһ±
+    uint32_t add_material(const shared_ptr<material>& m)
+    {
+        auto it = material_ids.find(m.get());
+        if (it != material_ids.end())
+            return it->second;
+
+        auto id = static_cast<uint32_t>(materials.size());
+        materials.push_back(m);
+        material_ids[m.get()] = id;
+        return id;
+    }
+
+    const material& mat(uint32_t id) const { return *materials[id]; }
+
+    // ͷ˳Ҫ
+    // 1. ȷԼегworldԴбȣüڴڴ
+    // 2. ղʱ±ʣµĲʡ
+    // 3. ж֮ͷڴأ򻹻ŵ shared_ptr ָѾͷŵڴ档
+    // жʱͷڴأ false
+    bool reset()
+    {
+        materials.clear();
+        material_ids.clear();
+
+        if (arena.live_allocations() != 0)
+            return false;
+        arena.release();
+        return true;
+    }
+
+public:
+    scene_arena arena;      // ֤
+    std::vector<shared_ptr<material>> materials;
+
+private:
+    std::unordered_map<const material*, uint32_t> material_ids;
+};
+
+// Ⱦõĳ
+inline scene_storage& current_scene()
+{
+    static scene_storage s;
+    return s;
+}
+
+// ʱ make_sharedŽǰڴ
+template <typename T, typename... Args>
+shared_ptr<T> arena_make(Args&&... args)
+{
+    return current_scene().make<T>(std::forward<Args>(args)...);
+}
+
+#endif
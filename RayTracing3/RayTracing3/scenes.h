@@ -0,0 +1,330 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <iostream>
+#include "rtweekend.h"
+#include "hittable_list.h"
+#include "sphere.h"
+#include "moving_sphere.h"
+#include "material.h"
+#include "texture.h"
+#include "bvh.h"
+#include "aarect.h"
+#include "box.h"
+#include "constant_medium.h"
+
+// Ⱦõĸʾ󶼴ӵǰڴ
+// ͼ stbi_load ȡͷļ .cpp ҪȰ stb_image.hﶨ STB_IMAGE_IMPLEMENTATION
+
+// 決 0 ʱѴʯΧڵŶԤȼֱʵɫʱֵ
+// ʵľ noise_bake_max_error ʱȻ
+int noise_bake_resolution = 0;
+real noise_bake_max_error = 0.02;
+
+void bake_noise(noise_texture& tex, const hittable& object)
+{
+    aabb box;
+    if (noise_bake_resolution <= 0 || !object.bounding_box(0, 1, box))
+        return;
+
+    tex.bake(box, noise_bake_resolution);
+
+    real max_error, rms_error;
+    tex.baked.measure_error(tex.noise, 100000, max_error, rms_error);
+    std::cout << "Baked turbulence " << noise_bake_resolution << "^3: " << tex.baked.bytes() / 1024 << " KiB, "
+              << "max error " << max_error << ", rms error " << rms_error << "\n";
+
+    if (rms_error > noise_bake_max_error)
+    {
+        tex.baked = turbulence_grid();
+        std::cout << "Baked turbulence discarded: rms error above " << noise_bake_max_error << "\n";
+    }
+}
+
+// 
+hittable_list random_scene() 
+{
+    hittable_list world;
+
+    auto checker = arena_make<checker_texture>(
+        arena_make<constant_texture>(vec3(0.2, 0.3, 0.1)),
+        arena_make<constant_texture>(vec3(0.9, 0.9, 0.9)));
+    world.add(arena_make<sphere>(vec3(0, -1000, 0), 1000, arena_make<lambertian>(checker)));
+
+    int i = 1;
+    for (int a = -5; a < 5; a++) 
+    {
+        for (int b = -5; b < 5; b++) 
+        {
+            auto choose_mat = random_double();
+            vec3 center(a + 0.9 * random_double(), 0.2, b + 0.9 * random_double());
+            if ((center - vec3(4, 0.2, 0)).length() > 0.9) 
+            {
+                if (choose_mat < 0.8) 
+                {
+                    // diffuse
+                    auto albedo = vec3::random() * vec3::random();
+                    world.add(arena_make<moving_sphere>(
+                        center, center + vec3(0, random_double(0, .5), 0), 0.0, 1.0, 0.2,
+                        arena_make<lambertian>(albedo)));
+                }
+                else if (choose_mat < 0.95) 
+                {
+                    // metal
+                    auto albedo = vec3::random(0.5, 1);
+                    auto fuzz = random_double(0, 0.5);
+                    world.add(arena_make<sphere>(center, 0.2, arena_make<metal>(albedo, fuzz)));
+                }
+                else 
+                {
+                    // glass
+                    world.add(arena_make<sphere>(center, 0.2, arena_make<dielectric>(1.5)));
+                }
+            }
+        }
+    }
+    world.add(arena_make<sphere>(vec3(0, 1, 0), 1.0, arena_make<dielectric>(1.5)));
+
+    world.add(arena_make<sphere>(vec3(-4, 1, 0), 1.0, arena_make<lambertian>(vec3(0.4, 0.2, 0.1))));
+
+    world.add(arena_make<sphere>(vec3(4, 1, 0), 1.0, arena_make<metal>(vec3(0.7, 0.6, 0.5), 0.0)));
+
+    return static_cast<hittable_list>(arena_make<bvh_node>(world, 0, 1));;
+}
+
+// 
+hittable_list two_spheres()
+{
+    hittable_list objects;
+
+    auto checker = arena_make<checker_texture>(
+        arena_make<constant_texture>(vec3(0.2, 0.3, 0.1)),
+        arena_make<constant_texture>(vec3(0.9, 0.9, 0.9)));
+
+    objects.add(arena_make<sphere>(vec3(0, -10, 0), 10, arena_make<lambertian>(checker)));
+    objects.add(arena_make<sphere>(vec3(0, 10, 0), 10, arena_make<lambertian>(checker)));
+
+    return objects;
+}
+
+// 
+hittable_list two_perlin_spheres()
+{
+    hittable_list objects;
+
+    auto pertext = arena_make<noise_texture>(4);
+    auto marble = arena_make<sphere>(vec3(0, 2, 0), 2, arena_make<lambertian>(pertext));
+    objects.add(arena_make<sphere>(vec3(0, -1000, 0), 1000, arena_make<lambertian>(pertext)));
+    objects.add(marble);
+    bake_noise(*pertext, *marble);
+
+    return objects;
+}
+
+// 
+hittable_list earth() {
+    int nx, ny, nn;
+    unsigned char* texture_data = stbi_load("image/earthmap.jpg", &nx, &ny, &nn, 0);
+
+    auto earth_surface = arena_make<lambertian>(arena_make<image_texture>(texture_data, nx, ny));
+    auto globe = arena_make<sphere>(vec3(0, 0, 0), 2, earth_surface);
+
+    return hittable_list(globe);
+}
+
+// 򵥵ľιԴ
+hittable_list simple_light() 
+{
+    hittable_list objects;
+
+    auto pertext = arena_make<noise_texture>(4);
+    auto marble = arena_make<sphere>(vec3(0, 2, 0), 2, arena_make<lambertian>(pertext));
+    objects.add(arena_make<sphere>(vec3(0, -1000, 0), 1000, arena_make<lambertian>(pertext)));
+    objects.add(marble);
+    bake_noise(*pertext, *marble);
+
+    auto difflight = arena_make<diffuse_light>(arena_make<constant_texture>(vec3(4, 4, 4)));
+    objects.add(arena_make<sphere>(vec3(0, 7, 0), 2, difflight));      // Դ
+    objects.add(arena_make<xy_rect>(3, 5, 1, 3, -2, difflight));       // ιԴ
+
+    return objects;
+}
+
+// ζӣǽ+
+hittable_list cornell_box() 
+{
+    hittable_list objects;
+
+    auto red = arena_make<lambertian>(vec3(0.65, 0.05, 0.05));
+    auto white = arena_make<lambertian>(vec3(0.73, 0.73, 0.73));
+    auto green = arena_make<lambertian>(vec3(0.12, 0.45, 0.15));
+    auto light = arena_make<diffuse_light>(vec3(15, 15, 15));
+
+    // ζ
+    objects.add(arena_make<yz_rect>(0, 555, 0, 555, 555, green));
+    objects.add(arena_make<yz_rect>(0, 555, 0, 555, 0, red));
+    objects.add(arena_make<flip_face>(arena_make<xz_rect>(213, 343, 227, 332, 554, light)));  // ת
+    objects.add(arena_make<xz_rect>(0, 555, 0, 555, 0, white));
+    objects.add(arena_make<xz_rect>(0, 555, 0, 555, 555, white));
+    objects.add(arena_make<xy_rect>(0, 555, 0, 555, 555, white));
+
+    // һ壬һ
+    //shared_ptr<material> aluminum = arena_make<metal>(color(0.8, 0.85, 0.88), 0.0);
+    //shared_ptr<hittable> box1 = arena_make<box>(vec3(0, 0, 0), vec3(165, 330, 165), aluminum);
+    shared_ptr<hittable> box1 = arena_make<box>(vec3(0, 0, 0), vec3(165, 330, 165), white);
+    box1 = arena_make<rotate_y>(box1, 15);
+    box1 = arena_make<translate>(box1, vec3(265, 0, 295));
+    objects.add(box1);
+
+    auto glass = arena_make<dielectric>(1.5);
+    objects.add(arena_make<sphere>(point3(190, 90, 190), 90, glass));
+
+    return objects;
+}
+
+// ζӣǽ+(ɫǳɫ)
+hittable_list cornell_smoke()
+{
+    hittable_list objects;
+
+    auto red = arena_make<lambertian>(vec3(0.65, 0.05, 0.05));
+    auto white = arena_make<lambertian>(vec3(0.73, 0.73, 0.73));
+    auto green = arena_make<lambertian>(vec3(0.12, 0.45, 0.15));
+    auto light = arena_make<diffuse_light>(vec3(15, 15, 15));
+
+    // ζ
+    objects.add(arena_make<yz_rect>(0, 555, 0, 555, 555, green));
+    objects.add(arena_make<yz_rect>(0, 555, 0, 555, 0, red));
+    objects.add(arena_make<xz_rect>(213, 343, 227, 332, 554, light));
+    objects.add(arena_make<xz_rect>(0, 555, 0, 555, 0, white));
+    objects.add(arena_make<xz_rect>(0, 555, 0, 555, 555, white));
+    objects.add(arena_make<xy_rect>(0, 555, 0, 555, 555, white));
+
+    shared_ptr<hittable> box1 = arena_make<box>(vec3(0, 0, 0), vec3(165, 330, 165), white);
+    box1 = arena_make<rotate_y>(box1, 15);
+    box1 = arena_make<translate>(box1, vec3(265, 0, 295));
+    shared_ptr<hittable> box2 = arena_make<box>(vec3(0, 0, 0), vec3(165, 165, 165), white);
+    box2 = arena_make<rotate_y>(box2, -18);
+    box2 = arena_make<translate>(box2, vec3(130, 0, 65));
+
+    objects.add(arena_make<constant_medium>(box1, 0.01, vec3(0, 0, 0)));
+    objects.add(arena_make<constant_medium>(box2, 0.01, vec3(1, 1, 1)));
+
+    return objects;
+}
+
+// ͨƶ򡢵򡢲򡢽򡢾ιԴʯ
+hittable_list final_scene()
+{
+    // ܶܶΪ
+    hittable_list boxes1;
+    auto ground = arena_make<lambertian>(vec3(0.48, 0.83, 0.53));
+
+    // ܼ400
+    const int boxes_per_side = 20;
+    for (int i = 0; i < boxes_per_side; i++)
+    {
+        for (int j = 0; j < boxes_per_side; j++)
+        {
+            auto w = 100.0;
+            auto x0 = -1000.0 + i * w;
+            auto y0 = 0.0;
+            auto z0 = -1000.0 + j * w;
+            auto x1 = x0 + w;
+            auto y1 = random_double(1, 101);
+            auto z1 = z0 + w;
+
+            boxes1.add(arena_make<box>(vec3(x0, y0, z0), vec3(x1, y1, z1), ground));
+        }
+    }
+
+    // 
+    hittable_list objects;
+    
+    // 
+    objects.add(arena_make<bvh_node>(boxes1, 0, 1));
+    // ιԴ
+    auto light = arena_make<diffuse_light>(vec3(15, 15, 15));
+    objects.add(arena_make<xz_rect>(123, 423, 147, 412, 554, light));
+
+    // ˶˶ģ
+    auto center1 = vec3(400, 400, 200);
+    auto center2 = center1 + vec3(30, 0, 0);
+    auto moving_sphere_material = arena_make<lambertian>(vec3(0.7, 0.3, 0.1));
+    objects.add(arena_make<moving_sphere>(center1, center2, 0, 1, 50, moving_sphere_material));
+
+    // ͽ
+    objects.add(arena_make<sphere>(vec3(260, 150, 45), 50, arena_make<dielectric>(1.5)));
+    objects.add(arena_make<sphere>(vec3(0, 150, 145), 50, arena_make<metal>(vec3(0.8, 0.8, 0.9), 1.0)));
+
+    // ɫα淴ڵdielectricڲ壩
+    auto boundary = arena_make<sphere>(vec3(360, 150, 145), 50, arena_make<dielectric>(1.5));
+    objects.add(boundary);
+    objects.add(arena_make<constant_medium>(boundary, 0.2, vec3(0.2, 0.4, 0.9)));
+    boundary = arena_make<sphere>(vec3(0, 0, 0), 5000, arena_make<dielectric>(1.5));
+    objects.add(arena_make<constant_medium>(boundary, 0.0001, vec3(1, 1, 1)));
+
+    // 
+    int nx, ny, nn;
+    auto tex_data = stbi_load("image/earthmap.jpg", &nx, &ny, &nn, 0);
+    auto emat = arena_make<lambertian>(arena_make<image_texture>(tex_data, nx, ny));
+    objects.add(arena_make<sphere>(vec3(400, 200, 400), 100, emat));
+
+    // ʯ򣨰
+    auto pertext = arena_make<noise_texture>(0.1);
+    objects.add(arena_make<sphere>(vec3(220, 280, 300), 80, arena_make<lambertian>(pertext)));
+
+    // 1000ɵ
+    hittable_list boxes2;
+    auto white = arena_make<lambertian>(vec3(0.73, 0.73, 0.73));
+    int ns = 1000;
+    for (int j = 0; j < ns; j++)
+    {
+        boxes2.add(arena_make<sphere>(vec3::random(0, 165), 10, white));
+    }
+    objects.add(arena_make<translate>
+               (arena_make<rotate_y>
+               (arena_make<bvh_node>(boxes2, 0.0, 1.0), 15), vec3(-100, 270, 395)));
+
+    return objects;
+}
+
+// ζӵǽڣ컨 48x48 ʸͬСԴԶԴ
+hittable_list many_lights()
+{
+    hittable_list objects;
+
+    auto red = arena_make<lambertian>(vec3(0.65, 0.05, 0.05));
+    auto white = arena_make<lambertian>(vec3(0.73, 0.73, 0.73));
+    auto green = arena_make<lambertian>(vec3(0.12, 0.45, 0.15));
+
+    objects.add(arena_make<yz_rect>(0, 555, 0, 555, 555, green));
+    objects.add(arena_make<yz_rect>(0, 555, 0, 555, 0, red));
+    objects.add(arena_make<xz_rect>(0, 555, 0, 555, 0, white));
+    objects.add(arena_make<xz_rect>(0, 555, 0, 555, 555, white));
+    objects.add(arena_make<xy_rect>(0, 555, 0, 555, 555, white));
+
+    shared_ptr<hittable> box1 = arena_make<box>(vec3(0, 0, 0), vec3(165, 330, 165), white);
+    box1 = arena_make<rotate_y>(box1, 15);
+    box1 = arena_make<translate>(box1, vec3(265, 0, 295));
+    objects.add(box1);
+
+    // ԴܰԼ 5% ĹԴ 20 
+    hittable_list bulbs;
+    const int bulbs_per_side = 48;
+    for (int i = 0; i < bulbs_per_side; i++)
+    {
+        for (int j = 0; j < bulbs_per_side; j++)
+        {
+            auto step = 515.0 / (bulbs_per_side - 1);
+            auto strength = random_double() < 0.05 ? 40.0 : 2.0;
+            auto emit = arena_make<diffuse_light>(vec3::random(0.2, 1) * strength);
+            bulbs.add(arena_make<sphere>(vec3(20 + i * step, 545, 20 + j * step), 3, emit));
+        }
+    }
+    objects.add(arena_make<bvh_node>(bulbs, 0, 1));
+
+    return objects;
+}
+
+#endif
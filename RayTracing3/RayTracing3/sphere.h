@@ -9,17 +9,45 @@ class sphere : public hittable
 {
 public:
     sphere() {}
-    sphere(vec3 cen, double r, shared_ptr<material> m) 
+    sphere(vec3 cen, real r, shared_ptr<material> m) 
         : center(cen), radius(r), mat_ptr(m) {};
 
-    virtual bool hit(const ray& r, double tmin, double tmax, hit_record& rec) const;
-    virtual bool bounding_box(double t0, double t1, aabb& output_box) const;
-    virtual double pdf_value(const point3& o, const vec3& v) const;
+    virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const;
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const;
+    virtual void get_hit_attributes(const ray& r, hit_record& rec) const;
+    virtual real pdf_value(const point3& o, const vec3& v) const;
     virtual vec3 random(const point3& o) const;
 
+    virtual void compile(scene_storage& scene) override
+    {
+        mat_id = scene.add_material(mat_ptr);
+    }
+
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const override
+    {
+        if (emits_light(mat_id))
+            lights.push_back(self);
+    }
+
+    virtual real light_power() const override
+    {
+        return 4 * pi * radius * radius * pi * emitted_luminance(mat_id);
+    }
+
+    virtual bool sample_point(surface_sample& s) const override
+    {
+        auto n = random_unit_vector();
+        s.p = center + radius * n;
+        s.normal = radius < 0 ? -n : n;
+        get_sphere_uv(n, s.u, s.v);
+        s.mat_id = mat_id;
+        s.area_pdf = 1 / (4 * pi * radius * radius);
+        return true;
+    }
+
 private:
     // ȡuv
-    static void get_sphere_uv(const vec3& p, double& u, double& v) {
+    static void get_sphere_uv(const vec3& p, real& u, real& v) {
         // p: a given point on the sphere of radius one, centered at the origin.
         // u: returned value [0,1] of angle around the Y axis from X=-1.
         // v: returned value [0,1] of angle from Y=-1 to Y=+1.
@@ -36,11 +64,12 @@ private:
 
 public:
     vec3 center;                    // Բ
-    double radius;                  // 뾶
-    shared_ptr<material> mat_ptr;   // 
+    real radius;                  // 뾶
+    shared_ptr<material> mat_ptr;
+    uint32_t mat_id = 0;            // ±꣬compile ֮Ч
 };
 
-bool sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) const 
+bool sphere::hit(const ray& r, real t_min, real t_max, hit_record& rec) const 
 {
     // ̣ax^2 + bx + c = 0
     vec3 oc = r.origin() - center;
@@ -57,29 +86,31 @@ bool sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) cons
         if (temp < t_max && temp > t_min) 
         {
             rec.t = temp;
-            rec.p = r.at(rec.t);
-            vec3 outward_normal = (rec.p - center) / radius;
-            rec.set_face_normal(r, outward_normal);
-            get_sphere_uv(outward_normal, rec.u, rec.v);
-            rec.mat_ptr = mat_ptr;
+            rec.object = this;
             return true;
         }
         temp = (-half_b + root) / a;
         if (temp < t_max && temp > t_min) 
         {
             rec.t = temp;
-            rec.p = r.at(rec.t);
-            vec3 outward_normal = (rec.p - center) / radius;
-            rec.set_face_normal(r, outward_normal);
-            get_sphere_uv(outward_normal, rec.u, rec.v);
-            rec.mat_ptr = mat_ptr;
+            rec.object = this;
             return true;
         }
     }
     return false;
 }
 
-bool sphere::bounding_box(double t0, double t1, aabb& output_box) const 
+// ֻĽ㷨ߡuvacosatan2Ͳ
+void sphere::get_hit_attributes(const ray& r, hit_record& rec) const
+{
+    rec.p = r.at(rec.t);
+    vec3 outward_normal = (rec.p - center) / radius;
+    rec.set_face_normal(r, outward_normal);
+    get_sphere_uv(outward_normal, rec.u, rec.v);
+    rec.mat_id = mat_id;
+}
+
+bool sphere::bounding_box(real t0, real t1, aabb& output_box) const 
 {
     output_box = aabb(
         center - vec3(radius, radius, radius),
@@ -87,16 +118,24 @@ bool sphere::bounding_box(double t0, double t1, aabb& output_box) const
     return true;
 }
 
-double sphere::pdf_value(const point3& o, const vec3& v) const
+// ɫųɵԲ׶ڲŻüнжϼɣҪ
+real sphere::pdf_value(const point3& o, const vec3& v) const
 {
-    hit_record rec;
-    if (!this->hit(ray(o, v), 0.001, infinity, rec))
+    auto oc = center - o;
+    auto distance_squared = oc.length_squared();
+    auto radius_squared = radius * radius;
+    if (distance_squared <= radius_squared)
+        return 0;
+
+    auto along = dot(oc, v);
+    if (along <= 0 || along * along < v.length_squared() * (distance_squared - radius_squared))
         return 0;
 
-    auto cos_theta_max = sqrt(1 - radius * radius / (center - o).length_squared());
-    auto solid_angle = 2 * pi * (1 - cos_theta_max);
+    // 1 - cos_theta_maxԶСֱᶪʧ
+    auto s = radius_squared / distance_squared;
+    auto one_minus_cos = s / (1 + sqrt(1 - s));
 
-    return 1 / solid_angle;
+    return 1 / (2 * pi * one_minus_cos);
 }
 
 vec3 sphere::random(const point3& o) const
@@ -2,12 +2,14 @@
 #define TEXTURE_H
 
 #include "rtweekend.h"
+#include "aabb.h"
 #include "perlin.h"
+#include "scene.h"
 
 class texture 
 {
 public:
-    virtual vec3 value(double u, double v, const vec3& p) const = 0;
+    virtual vec3 value(real u, real v, const vec3& p) const = 0;
 };
 
 // ̶
@@ -17,7 +19,7 @@ public:
     constant_texture() {}
     constant_texture(vec3 c) : color(c) {}
 
-    virtual vec3 value(double u, double v, const vec3& p) const 
+    virtual vec3 value(real u, real v, const vec3& p) const 
     {
         return color;
     }
@@ -34,9 +36,9 @@ public:
     checker_texture() {}
     checker_texture(shared_ptr<texture> t0, shared_ptr<texture> t1) : even(t0), odd(t1) {}
     checker_texture(vec3& c1, vec3& c2) 
-        : even(make_shared<constant_texture>(c1)), odd(make_shared<constant_texture>(c2)) {}
+        : even(arena_make<constant_texture>(c1)), odd(arena_make<constant_texture>(c2)) {}
 
-    virtual vec3 value(double u, double v, const vec3& p) const 
+    virtual vec3 value(real u, real v, const vec3& p) const 
     {
         auto sines = sin(10 * p.x()) * sin(10 * p.y()) * sin(10 * p.z());
         if (sines < 0)
@@ -47,8 +49,8 @@ public:
 
 public:
     // żָָһ̬, ҲָһЩɵ
-    shared_ptr<texture> odd;
     shared_ptr<texture> even;
+    shared_ptr<texture> odd;
 };
 
 // 
@@ -56,21 +58,30 @@ class noise_texture : public texture
 {
 public:
     noise_texture() {}
-    noise_texture(double sc) : scale(sc) {}
+    noise_texture(real sc) : scale(sc) {}
 
-    virtual vec3 value(double u, double v, const vec3& p) const
+    virtual vec3 value(real u, real v, const vec3& p) const
     {
         // ֲֵΪ
         // ӳ䵽01֮
         //return vec3(1, 1, 1) * 0.5 * (1.0 + noise.noise(scale * p));
         // ʯɫsinֵɱʹŶȡλƽsin(x)еx
         // ʹô״
-        return vec3(1, 1, 1) * 0.5 * (1 + sin(scale*p.z() + 10*noise.turb(p)));
+        // 決ֱӲֵ
+        auto turb = !baked.empty() && baked.contains(p) ? baked.lookup(p) : noise.turb(p);
+        return vec3(1, 1, 1) * 0.5 * (1 + sin(scale*p.z() + 10*turb));
+    }
+
+    // ѰΧڵŶԤȼ res^3 
+    void bake(const aabb& box, int res)
+    {
+        baked.bake(noise, box.min(), box.max(), res);
     }
 
 public:
     perlin noise;
-    double scale;   // 仯Ƶʣķ仯
+    real scale;   // 仯Ƶʣķ仯
+    turbulence_grid baked;
 };
 
 // ͼƬ
@@ -84,7 +95,7 @@ public:
         delete data;
     }
 
-    virtual vec3 value(double u, double v, const vec3& p) const {
+    virtual vec3 value(real u, real v, const vec3& p) const {
         // If we have no texture data, then always emit cyan (as a debugging aid).
         if (data == nullptr)
             return vec3(0, 1, 1);
@@ -0,0 +1,247 @@
+#ifndef TYPED_LIST_H
+#define TYPED_LIST_H
+
+#include <typeinfo>
+#include <type_traits>
+#include <vector>
+#include "rtweekend.h"
+#include "hittable.h"
+#include "sphere.h"
+#include "moving_sphere.h"
+#include "aarect.h"
+#include "box.h"
+#include "constant_medium.h"
+
+// ͼϵб
+// ֪ͼԪͰͷ顢ֵţʱ޶ object.T::hit ֱӵã
+// 麯԰ͬһ󽻴ѭ
+// ͣûԼչ hittableŽ othersȻ麯
+class typed_list : public hittable
+{
+public:
+    typed_list() {}
+    typed_list(const std::vector<shared_ptr<hittable>>& objects) : typed_list(objects, 0, objects.size()) {}
+    typed_list(const std::vector<shared_ptr<hittable>>& objects, size_t start, size_t end)
+    {
+        for (size_t i = start; i < end; i++)
+            add(objects[i]);
+    }
+
+    void add(shared_ptr<hittable> object);
+    size_t size() const;
+
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+    virtual bool bounding_box(real t0, real t1, aabb& output_box) const override;
+    virtual real pdf_value(const point3& o, const vec3& v) const override;
+    virtual vec3 random(const point3& o) const override;
+    virtual void collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const override;
+    virtual void compile(scene_storage& scene) override;
+
+public:
+    std::vector<sphere> spheres;
+    std::vector<moving_sphere> moving_spheres;
+    std::vector<xy_rect> xy_rects;
+    std::vector<xz_rect> xz_rects;
+    std::vector<yz_rect> yz_rects;
+    std::vector<box> boxes;
+    std::vector<translate> translates;
+    std::vector<rotate_y> rotations;
+    std::vector<flip_face> flipped;
+    std::vector<constant_medium> media;
+    std::vector<shared_ptr<hittable>> others;
+
+private:
+    // ηÿһͷ飨 others
+    template <typename F>
+    void for_each_group(F&& f) const
+    {
+        f(spheres);
+        f(moving_spheres);
+        f(xy_rects);
+        f(xz_rects);
+        f(yz_rects);
+        f(boxes);
+        f(translates);
+        f(rotations);
+        f(flipped);
+        f(media);
+    }
+
+    // ʱҪ޸İֵŵͼԪ
+    template <typename F>
+    void for_each_group(F&& f)
+    {
+        f(spheres);
+        f(moving_spheres);
+        f(xy_rects);
+        f(xz_rects);
+        f(yz_rects);
+        f(boxes);
+        f(translates);
+        f(rotations);
+        f(flipped);
+        f(media);
+    }
+
+    // ֻȫһ²ŰֵԽ othersƬ
+    template <typename T>
+    static bool try_add(const shared_ptr<hittable>& object, std::vector<T>& group)
+    {
+        if (typeid(*object) != typeid(T))
+            return false;
+        group.push_back(static_cast<const T&>(*object));
+        return true;
+    }
+};
+
+void typed_list::add(shared_ptr<hittable> object)
+{
+    if (try_add(object, spheres) || try_add(object, moving_spheres) ||
+        try_add(object, xy_rects) || try_add(object, xz_rects) || try_add(object, yz_rects) ||
+        try_add(object, boxes) || try_add(object, translates) || try_add(object, rotations) ||
+        try_add(object, flipped) || try_add(object, media))
+        return;
+
+    others.push_back(object);
+}
+
+size_t typed_list::size() const
+{
+    size_t n = others.size();
+    for_each_group([&](const auto& group) { n += group.size(); });
+    return n;
+}
+
+bool typed_list::hit(const ray& r, real t_min, real t_max, hit_record& rec) const
+{
+    bool hit_anything = false;
+    auto closest_so_far = t_max;
+
+    // ͼԪֻڻʱд recԿֱд recҪʱ¼
+    for_each_group([&](const auto& group)
+    {
+        using T = typename std::decay_t<decltype(group)>::value_type;
+        for (const auto& object : group)
+        {
+            if (object.T::hit(r, t_min, closest_so_far, rec))
+            {
+                hit_anything = true;
+                closest_so_far = rec.t;
+            }
+        }
+    });
+
+    for (const auto& object : others)
+    {
+        if (object->hit(r, t_min, closest_so_far, rec))
+        {
+            hit_anything = true;
+            closest_so_far = rec.t;
+        }
+    }
+
+    return hit_anything;
+}
+
+bool typed_list::bounding_box(real t0, real t1, aabb& output_box) const
+{
+    bool first_box = true;
+    bool all_bounded = true;
+    aabb temp_box;
+
+    auto merge = [&](const hittable& object)
+    {
+        if (!object.bounding_box(t0, t1, temp_box))
+        {
+            all_bounded = false;
+            return;
+        }
+        output_box = first_box ? temp_box : surrounding_box(output_box, temp_box);
+        first_box = false;
+    };
+
+    for_each_group([&](const auto& group)
+    {
+        for (const auto& object : group)
+            merge(object);
+    });
+    for (const auto& object : others)
+        merge(*object);
+
+    return all_bounded && !first_box;
+}
+
+//  hittable_list һÿȨͬ
+real typed_list::pdf_value(const point3& o, const vec3& v) const
+{
+    auto weight = real(1) / size();
+    auto sum = real(0);
+
+    for_each_group([&](const auto& group)
+    {
+        using T = typename std::decay_t<decltype(group)>::value_type;
+        for (const auto& object : group)
+            sum += weight * object.T::pdf_value(o, v);
+    });
+    for (const auto& object : others)
+        sum += weight * object->pdf_value(o, v);
+
+    return sum;
+}
+
+vec3 typed_list::random(const point3& o) const
+{
+    if (size() == 0)
+        return vec3(1, 0, 0);
+
+    auto index = static_cast<size_t>(sample_int(sample_dim::bounce_light, 0, static_cast<int>(size()) - 1));
+    vec3 result(1, 0, 0);
+    bool found = false;
+
+    for_each_group([&](const auto& group)
+    {
+        if (found)
+            return;
+        if (index < group.size())
+        {
+            result = group[index].random(o);
+            found = true;
+        }
+        else
+        {
+            index -= group.size();
+        }
+    });
+
+    if (found)
+        return result;
+    return index < others.size() ? others[index]->random(o) : vec3(1, 0, 0);
+}
+
+// 尴ֵţбȨ shared_ptr ָ
+void typed_list::collect_lights(const shared_ptr<hittable>& self, std::vector<shared_ptr<hittable>>& lights) const
+{
+    for_each_group([&](const auto& group)
+    {
+        using T = typename std::decay_t<decltype(group)>::value_type;
+        for (const auto& object : group)
+            object.T::collect_lights(shared_ptr<hittable>(self, const_cast<T*>(&object)), lights);
+    });
+    for (const auto& object : others)
+        object->collect_lights(object, lights);
+}
+
+// ֵŵǹ typed_list ʱͼԪҪЩ
+void typed_list::compile(scene_storage& scene)
+{
+    for_each_group([&](auto& group)
+    {
+        using T = typename std::decay_t<decltype(group)>::value_type;
+        for (auto& object : group)
+            object.T::compile(scene);
+    });
+    for (const auto& object : others)
+        object->compile(scene);
+}
+
+#endif
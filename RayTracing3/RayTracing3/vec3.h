@@ -8,15 +8,15 @@ class vec3
 {
 public:
     vec3() : e{ 0,0,0 } {}
-    vec3(double e0, double e1, double e2) : e{ e0, e1, e2 } {}
+    vec3(real e0, real e1, real e2) : e{ e0, e1, e2 } {}
 
-    double x() const { return e[0]; }
-    double y() const { return e[1]; }
-    double z() const { return e[2]; }
+    real x() const { return e[0]; }
+    real y() const { return e[1]; }
+    real z() const { return e[2]; }
 
     vec3 operator-() const { return vec3(-e[0], -e[1], -e[2]); }
-    double operator[](int i) const { return e[i]; }
-    double& operator[](int i) { return e[i]; }
+    real operator[](int i) const { return e[i]; }
+    real& operator[](int i) { return e[i]; }
 
     vec3& operator+=(const vec3& v) 
     {
@@ -26,7 +26,7 @@ public:
         return *this;
     }
 
-    vec3& operator*=(const double t) 
+    vec3& operator*=(const real t) 
     {
         e[0] *= t;
         e[1] *= t;
@@ -34,17 +34,17 @@ public:
         return *this;
     }
 
-    vec3& operator/=(const double t) 
+    vec3& operator/=(const real t) 
     {
         return *this *= 1 / t;
     }
 
-    double length() const 
+    real length() const 
     {
         return sqrt(length_squared());
     }
 
-    double length_squared() const 
+    real length_squared() const 
     {
         return e[0] * e[0] + e[1] * e[1] + e[2] * e[2];
     }
@@ -61,13 +61,13 @@ public:
         return vec3(random_double(), random_double(), random_double());
     }
 
-    inline static vec3 random(double min, double max)
+    inline static vec3 random(real min, real max)
     {
         return vec3(random_double(min, max), random_double(min, max), random_double(min, max));
     }
 
 public:
-    double e[3];
+    real e[3];
 };
 
 inline std::ostream& operator<<(std::ostream& out, const vec3& v) 
@@ -90,22 +90,22 @@ inline vec3 operator*(const vec3& u, const vec3& v)
     return vec3(u.e[0] * v.e[0], u.e[1] * v.e[1], u.e[2] * v.e[2]);
 }
 
-inline vec3 operator*(double t, const vec3& v) 
+inline vec3 operator*(real t, const vec3& v) 
 {
     return vec3(t * v.e[0], t * v.e[1], t * v.e[2]);
 }
 
-inline vec3 operator*(const vec3& v, double t) 
+inline vec3 operator*(const vec3& v, real t) 
 {
     return t * v;
 }
 
-inline vec3 operator/(vec3 v, double t) 
+inline vec3 operator/(vec3 v, real t) 
 {
     return (1 / t) * v;
 }
 
-inline double dot(const vec3& u, const vec3& v) 
+inline real dot(const vec3& u, const vec3& v) 
 {
     return u.e[0] * v.e[0]
         + u.e[1] * v.e[1]
@@ -166,7 +166,7 @@ vec3 reflect(const vec3& v, const vec3& n)
 // 
 // uvⷽnһķ
 // etai_over_etatһʵ/һʵ
-vec3 refract(const vec3& uv, const vec3& n, double etai_over_etat) 
+vec3 refract(const vec3& uv, const vec3& n, real etai_over_etat) 
 {
     auto cos_theta = dot(-uv, n);
     // ߵˮƽ
@@ -178,7 +178,7 @@ vec3 refract(const vec3& uv, const vec3& n, double etai_over_etat)
 
 // ʵеĲ, ĸʻǶı
 // SchlickĽƵĵʽ
-double schlick(double cosine, double ref_idx) {
+real schlick(real cosine, real ref_idx) {
     auto r0 = (1 - ref_idx) / (1 + ref_idx);
     r0 = r0 * r0;
     return r0 + (1 - r0) * pow((1 - cosine), 5);
@@ -0,0 +1,500 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "rtweekend.h"
+#include "hittable.h"
+#include "material.h"
+#include "camera.h"
+#include "ray_packet.h"
+#include "light_list.h"
+
+// ǰwavefront
+// ray_color ÿ·󽻡ʼ㡢PDF ͬʵĴ뽻ִУ
+// Ϊһδһ·ÿһɡ󽻡ɫӰߡѹ
+// ִһ顣ߺ·״̬ SoA ţ󽻸ù߰ӿڣ
+// ɫǰͬһֲʵ·ִС ray_color ͳһ
+
+// SoA ֵĹ߶
+struct ray_queue
+{
+    std::vector<real> ox, oy, oz;           // 
+    std::vector<real> dx, dy, dz;           // 
+    std::vector<real> time;
+
+    void resize(size_t n)
+    {
+        ox.resize(n); oy.resize(n); oz.resize(n);
+        dx.resize(n); dy.resize(n); dz.resize(n);
+        time.resize(n);
+    }
+
+    void set(size_t i, const ray& r)
+    {
+        ox[i] = r.origin().x(); oy[i] = r.origin().y(); oz[i] = r.origin().z();
+        dx[i] = r.direction().x(); dy[i] = r.direction().y(); dz[i] = r.direction().z();
+        time[i] = r.time();
+    }
+
+    ray get(size_t i) const
+    {
+        return ray(point3(ox[i], oy[i], oz[i]), vec3(dx[i], dy[i], dz[i]), time[i]);
+    }
+
+    void move(size_t from, size_t to)
+    {
+        ox[to] = ox[from]; oy[to] = oy[from]; oz[to] = oz[from];
+        dx[to] = dx[from]; dy[to] = dy[from]; dz[to] = dz[from];
+        time[to] = time[from];
+    }
+};
+
+// ÿ·״̬
+struct path_queue
+{
+    ray_queue rays;
+    std::vector<real> beta_r, beta_g, beta_b;   // ·֮ǰε˥֮
+    std::vector<int> pixel;                     // 
+    std::vector<int> sample;                    // ڵţͲȷ
+    std::vector<int> depth;                     // ʣ൯ ray_color  depth ͬ
+    std::vector<real> bsdf_pdf;                 // õǰߵ BSDF ܶȣ0 ʾҪ MIS
+    std::vector<unsigned char> alive;           // 0 ʾ·Ѿѹ׶Ƴ
+
+    void resize(size_t n)
+    {
+        rays.resize(n);
+        beta_r.resize(n); beta_g.resize(n); beta_b.resize(n);
+        pixel.resize(n);
+        sample.resize(n);
+        depth.resize(n);
+        bsdf_pdf.resize(n);
+        alive.resize(n);
+    }
+
+    color beta(size_t i) const { return color(beta_r[i], beta_g[i], beta_b[i]); }
+
+    void set_beta(size_t i, const color& c)
+    {
+        beta_r[i] = c.x(); beta_g[i] = c.y(); beta_b[i] = c.z();
+    }
+
+    void move(size_t from, size_t to)
+    {
+        rays.move(from, to);
+        beta_r[to] = beta_r[from]; beta_g[to] = beta_g[from]; beta_b[to] = beta_b[from];
+        pixel[to] = pixel[from];
+        sample[to] = sample[from];
+        depth[to] = depth[from];
+        bsdf_pdf[to] = bsdf_pdf[from];
+        alive[to] = alive[from];
+    }
+
+    // һпһ·ʱʹ
+    void copy(const path_queue& src, size_t from, size_t to)
+    {
+        rays.ox[to] = src.rays.ox[from]; rays.oy[to] = src.rays.oy[from]; rays.oz[to] = src.rays.oz[from];
+        rays.dx[to] = src.rays.dx[from]; rays.dy[to] = src.rays.dy[from]; rays.dz[to] = src.rays.dz[from];
+        rays.time[to] = src.rays.time[from];
+        beta_r[to] = src.beta_r[from]; beta_g[to] = src.beta_g[from]; beta_b[to] = src.beta_b[from];
+        pixel[to] = src.pixel[from];
+        sample[to] = src.sample[from];
+        depth[to] = src.depth[from];
+        bsdf_pdf[to] = src.bsdf_pdf[from];
+        alive[to] = src.alive[from];
+    }
+};
+
+//  10 λÿһλ֮ 0ƴά Morton 
+inline uint32_t expand_bits(uint32_t x)
+{
+    x = (x * 0x00010001u) & 0xFF0000FFu;
+    x = (x * 0x00000101u) & 0x0F00F00Fu;
+    x = (x * 0x00000011u) & 0xC30C30C3u;
+    x = (x * 0x00000005u) & 0x49249249u;
+    return x;
+}
+
+// ӰߣдԷ contribution ӵ
+struct shadow_queue
+{
+    ray_queue rays;
+    std::vector<color> contribution;
+    std::vector<int> pixel;
+    size_t count = 0;
+
+    void clear() { count = 0; }
+
+    void push(const ray& r, const color& c, int pix)
+    {
+        if (count == pixel.size())
+        {
+            rays.resize(count + 1);
+            contribution.resize(count + 1);
+            pixel.resize(count + 1);
+        }
+        rays.set(count, r);
+        contribution[count] = c;
+        pixel[count] = pix;
+        count++;
+    }
+};
+
+class wavefront_integrator
+{
+public:
+    wavefront_integrator(const hittable& w, const light_list& l, const color& bg, int max_d, size_t batch = 1 << 12)
+        : world(w), lights(l), background(bg), max_depth(max_d), batch_size(batch)
+    {
+        paths.resize(batch_size);
+        binned.resize(batch_size);
+        hits.resize(batch_size);
+        order.resize(batch_size);
+        keys.resize(batch_size);
+        key_tmp.resize(batch_size);
+        order_tmp.resize(batch_size);
+    }
+
+    // Ⱦͼimage  j * width + i ÿصɫ֮ͣj = 0 ΪһУ
+    void render(camera& cam, int width, int height, int samples_per_pixel, std::vector<color>& image);
+
+private:
+    void generate(camera& cam);
+    void bin_rays();
+    void intersect();
+    void sort_by_material();
+    void shade();
+    void trace_shadows();
+    void compact();
+
+public:
+    // ǰ޺ڸӣMorton 룩
+    // λĹBVHʵĽڵ໹ڻ
+    bool reorder_rays = false;
+    int rr_min_depth = 3;           // ô֮ʼ˹
+    bool next_event = true;         // ֱӹղ + MIS shade  next_event_estimation ͬ
+    long long rays_traced = 0;      // ͳƣ󽻵ĹӰߣ
+    long long shadow_rays_traced = 0;
+
+private:
+    const hittable& world;
+    const light_list& lights;
+    color background;
+    int max_depth;
+    size_t batch_size;
+
+    path_queue paths;
+    path_queue binned;              // ʱĿУ paths 
+    std::vector<hit_record> hits;
+    std::vector<uint32_t> order;    // ·±꣬ɫ˳ִ
+    std::vector<uint32_t> counts;   // ãÿֲһͰ
+    std::vector<uint32_t> keys;     // ŵ
+    std::vector<uint32_t> key_tmp;
+    std::vector<uint32_t> order_tmp;
+    shadow_queue shadows;
+    size_t num_paths = 0;           // лԾ·
+    size_t num_hits = 0;            // ε·
+
+    std::vector<color>* film = nullptr;
+    int image_width = 0;
+    int image_height = 0;
+    long long next_sample = 0;      // һҪɵ
+    long long total_samples = 0;
+};
+
+void wavefront_integrator::render(camera& cam, int width, int height, int samples_per_pixel, std::vector<color>& image)
+{
+    image.assign(size_t(width) * height, color(0, 0, 0));
+    film = &image;
+    image_width = width;
+    image_height = height;
+    next_sample = 0;
+    total_samples = (long long)width * height * samples_per_pixel;
+    num_paths = 0;
+
+    // ÿһְѿճλòµߣֱɲҶ
+    while (next_sample < total_samples || num_paths > 0)
+    {
+        generate(cam);
+        if (reorder_rays)
+            bin_rays();
+        intersect();
+        sort_by_material();
+        shade();
+        trace_shadows();
+        compact();
+    }
+
+    film = nullptr;
+}
+
+// ɨ˳ţͬһֵ·أ߸߶һ
+void wavefront_integrator::generate(camera& cam)
+{
+    auto num_pixels = (long long)image_width * image_height;
+
+    while (num_paths < batch_size && next_sample < total_samples)
+    {
+        int p = static_cast<int>(next_sample % num_pixels);
+        int i = p % image_width;
+        int j = p / image_width;
+
+        int s = static_cast<int>(next_sample / num_pixels);
+
+        if (auto sampler = active_sampler())
+            sampler->start_sample(p, s);
+        auto u = (i + sample_1d(sample_dim::pixel_x)) / (image_width - 1);
+        auto v = (j + sample_1d(sample_dim::pixel_y)) / (image_height - 1);
+        paths.rays.set(num_paths, cam.get_ray(u, v));
+        paths.set_beta(num_paths, color(1, 1, 1));
+        paths.pixel[num_paths] = p;
+        paths.sample[num_paths] = s;
+        paths.depth[num_paths] = max_depth;
+        paths.bsdf_pdf[num_paths] = 0;
+        paths.alive[num_paths] = true;
+
+        num_paths++;
+        next_sample++;
+    }
+}
+
+//  3 λǷޣ 27 λڱ߰Χڰ 512^3  Morton 
+// ߰ɨ˳ɣѾһ£йȦʱ򷴶ң
+// Ϊ 0 ǰ棻ȶģ֮˳򲻱
+void wavefront_integrator::bin_rays()
+{
+    if (num_paths < 2)
+        return;
+
+    const ray_queue& q = paths.rays;
+    point3 lo(infinity, infinity, infinity);
+    point3 hi(-infinity, -infinity, -infinity);
+    for (size_t i = 0; i < num_paths; i++)
+    {
+        if (paths.depth[i] == max_depth)
+            continue;
+        lo = point3(ffmin(lo.x(), q.ox[i]), ffmin(lo.y(), q.oy[i]), ffmin(lo.z(), q.oz[i]));
+        hi = point3(ffmax(hi.x(), q.ox[i]), ffmax(hi.y(), q.oy[i]), ffmax(hi.z(), q.oz[i]));
+    }
+
+    const real cells = 511;
+    real scale[3];
+    for (int a = 0; a < 3; a++)
+        scale[a] = hi[a] > lo[a] ? cells / (hi[a] - lo[a]) : 0;
+
+    for (size_t i = 0; i < num_paths; i++)
+    {
+        order[i] = static_cast<uint32_t>(i);
+        if (paths.depth[i] == max_depth)
+        {
+            keys[i] = 0;
+            continue;
+        }
+
+        auto cx = static_cast<uint32_t>((q.ox[i] - lo.x()) * scale[0]);
+        auto cy = static_cast<uint32_t>((q.oy[i] - lo.y()) * scale[1]);
+        auto cz = static_cast<uint32_t>((q.oz[i] - lo.z()) * scale[2]);
+        uint32_t octant = (q.dx[i] < 0 ? 4u : 0u) | (q.dy[i] < 0 ? 2u : 0u) | (q.dz[i] < 0 ? 1u : 0u);
+
+        keys[i] = 1u << 30 | octant << 27 | expand_bits(cx) << 2 | expand_bits(cy) << 1 | expand_bits(cz);
+    }
+
+    // 31 λļÿ 8 λ 4 
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        uint32_t bucket[257] = { 0 };
+        for (size_t i = 0; i < num_paths; i++)
+            bucket[(keys[i] >> shift & 0xFF) + 1]++;
+        for (int b = 1; b < 257; b++)
+            bucket[b] += bucket[b - 1];
+        for (size_t i = 0; i < num_paths; i++)
+        {
+            auto dst = bucket[keys[i] >> shift & 0xFF]++;
+            key_tmp[dst] = keys[i];
+            order_tmp[dst] = order[i];
+        }
+        keys.swap(key_tmp);
+        order.swap(order_tmp);
+    }
+
+    for (size_t i = 0; i < num_paths; i++)
+        binned.copy(paths, order[i], i);
+    std::swap(paths, binned);
+}
+
+// ÿ packet_size һ߰BVHûле·ѱɫӵϲ
+void wavefront_integrator::intersect()
+{
+    for (size_t i0 = 0; i0 < num_paths; i0 += packet_size)
+    {
+        ray_packet rp;
+        real t_max[packet_size];
+        unsigned active = 0;
+        for (int k = 0; k < packet_size; k++)
+            t_max[k] = -infinity;           // ûйߵͨκΰΧжཻ
+
+        for (size_t k = 0; k < packet_size && i0 + k < num_paths; k++)
+        {
+            // ·й
+            if (paths.depth[i0 + k] <= 0)
+            {
+                paths.alive[i0 + k] = false;
+                continue;
+            }
+            rp.set(static_cast<int>(k), paths.rays.get(i0 + k));
+            t_max[k] = infinity;
+            active |= 1u << k;
+            rays_traced++;
+        }
+
+        unsigned hit_mask = world.hit_packet(rp, 0.001, t_max, &hits[i0], active);
+
+        for (size_t k = 0; k < packet_size && i0 + k < num_paths; k++)
+        {
+            if (!(active >> k & 1) || (hit_mask >> k & 1))
+                continue;
+            (*film)[paths.pixel[i0 + k]] += paths.beta(i0 + k) * background;
+            paths.alive[i0 + k] = false;
+        }
+    }
+}
+
+// Ȳȫԣٰ±
+void wavefront_integrator::sort_by_material()
+{
+    counts.assign(current_scene().materials.size() + 1, 0);
+
+    for (size_t i = 0; i < num_paths; i++)
+    {
+        if (!paths.alive[i])
+            continue;
+        hits[i].resolve(paths.rays.get(i));
+        counts[hits[i].mat_id + 1]++;
+    }
+
+    for (size_t m = 1; m < counts.size(); m++)
+        counts[m] += counts[m - 1];
+
+    num_hits = counts.back();
+    for (size_t i = 0; i < num_paths; i++)
+    {
+        if (paths.alive[i])
+            order[counts[hits[i].mat_id]++] = static_cast<uint32_t>(i);
+    }
+}
+
+//  shade ͬĹƣԷ⣨ MIS Ȩһɢ䣬ɢĹдضУ
+// ͨ۳ˣ rr_min_depth ֮ͬ˹ֱ̡ӹյӰ߷Ž
+// ӰУɫһ׷
+void wavefront_integrator::shade()
+{
+    for (size_t n = 0; n < num_hits; n++)
+    {
+        auto i = order[n];
+        const hit_record& rec = hits[i];
+        ray r = paths.rays.get(i);
+        color beta = paths.beta(i);
+
+        // ·ִУɫǰָ·͵
+        int bounce = max_depth - paths.depth[i];
+        if (auto sampler = active_sampler())
+        {
+            sampler->start_sample(paths.pixel[i], paths.sample[i]);
+            sampler->set_bounce(bounce);
+        }
+
+        scatter_record srec;
+        const material& mat = current_scene().mat(rec.mat_id);
+        auto emitted = mat.emitted(r, rec, rec.u, rec.v, rec.p);
+        if (paths.bsdf_pdf[i] > 0 && (emitted.x() > 0 || emitted.y() > 0 || emitted.z() > 0))
+            emitted *= power_heuristic(paths.bsdf_pdf[i], lights.pdf_value(r.origin(), r.direction()));
+        (*film)[paths.pixel[i]] += beta * emitted;
+        paths.depth[i]--;
+
+        if (!mat.scatter(r, rec, srec))
+        {
+            paths.alive[i] = false;
+            continue;
+        }
+
+        if (srec.is_specular)
+        {
+            beta = beta * srec.attenuation;
+            paths.rays.set(i, srec.specular_ray);
+            paths.bsdf_pdf[i] = 0;
+        }
+        else if (next_event)
+        {
+            ray shadow;
+            color weight;
+            sample_bounce(bounce, true);
+            if (sample_light(lights, r, rec, srec, mat, shadow, weight))
+                shadows.push(shadow, beta * weight, paths.pixel[i]);
+
+            sample_bounce(bounce);
+            ray scattered = ray(rec.p, srec.surface_pdf.generate(), r.time());
+            auto pdf_val = srec.surface_pdf.value(scattered.direction());
+            if (!(pdf_val > 0))
+            {
+                paths.alive[i] = false;
+                continue;
+            }
+
+            beta = beta * srec.attenuation * mat.scattering_pdf(r, rec, scattered) / pdf_val;
+            paths.rays.set(i, scattered);
+            paths.bsdf_pdf[i] = pdf_val;
+        }
+        else
+        {
+            // ûйԴʱֻ BSDF  shade ͬ
+            hittable_pdf light_pdf(lights, rec.p);
+            mixture_pdf mixture(light_pdf, srec.surface_pdf);
+            const pdf& p = lights.empty() ? static_cast<const pdf&>(srec.surface_pdf) : mixture;
+
+            ray scattered = ray(rec.p, p.generate(), r.time());
+            auto pdf_val = p.value(scattered.direction());
+
+            beta = beta * srec.attenuation * mat.scattering_pdf(r, rec, scattered) / pdf_val;
+            paths.rays.set(i, scattered);
+        }
+
+        if (paths.depth[i] > 0 && max_depth - paths.depth[i] >= rr_min_depth)
+        {
+            auto survive = ffmin(ffmax(beta.x(), ffmax(beta.y(), beta.z())), real(0.95));
+            if (!(random_double() < survive))
+            {
+                paths.alive[i] = false;
+                continue;
+            }
+            beta /= survive;
+        }
+        paths.set_beta(i, beta);
+    }
+}
+
+// Դбֻõ״ԷҪӳеȡӰ
+void wavefront_integrator::trace_shadows()
+{
+    for (size_t i = 0; i < shadows.count; i++)
+        (*film)[shadows.pixel[i]] += shadows.contribution[i] * shadow_emission(world, shadows.rays.get(i));
+    shadow_rays_traced += shadows.count;
+    shadows.clear();
+}
+
+// Ȼ·ԭ˳Ƶǰ
+void wavefront_integrator::compact()
+{
+    size_t n = 0;
+    for (size_t i = 0; i < num_paths; i++)
+    {
+        if (!paths.alive[i])
+            continue;
+        if (i != n)
+            paths.move(i, n);
+        n++;
+    }
+    num_paths = n;
+}
+
+#endif